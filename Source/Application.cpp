@@ -1,6 +1,7 @@
 
 #include "Module.h"
 #include "ModuleWindow.h"
+#include "ModuleInput.h"
 #include "ModuleRender.h"
 #include "ModuleAudio.h"
 #include "ModulePhysics.h"
@@ -8,10 +9,12 @@
 
 #include "Application.h"
 
-Application::Application()
+Application::Application(bool headless, uint64 max_frames) : headless(headless), max_frames(max_frames)
 {
-	window = new ModuleWindow(this);
-	renderer = new ModuleRender(this);
+	// Headless runs never open a window, the renderer stays disabled so Draw calls are no-ops
+	window = headless ? nullptr : new ModuleWindow(this);
+	input = new ModuleInput(this);
+	renderer = new ModuleRender(this, !headless);
 	audio = new ModuleAudio(this, true);
 	physics = new ModulePhysics(this);
 	scene_intro = new ModuleGame(this);
@@ -21,15 +24,17 @@ Application::Application()
 	// They will CleanUp() in reverse order
 
 	// Main Modules
-	AddModule(window);
-	AddModule(physics);
-	AddModule(audio);
+	if (window != nullptr)
+		AddModule(window, "window");
+	AddModule(input, "input");
+	AddModule(physics, "physics");
+	AddModule(audio, "audio");
 	
 	// Scenes
-	AddModule(scene_intro);
+	AddModule(scene_intro, "game");
 
 	// Rendering happens at the end
-	AddModule(renderer);
+	AddModule(renderer, "renderer");
 }
 
 Application::~Application()
@@ -46,12 +51,18 @@ Application::~Application()
 bool Application::Init()
 {
 	bool ret = true;
+	startup_time.Start();
+
+	// Before Init: modules queue their assets from Init and Start
+	assets.Start();
 
 	// Call Init() in all modules
 	for (auto it = list_modules.begin(); it != list_modules.end() && ret; ++it)
 	{
 		Module* module = *it;
+		uint64 started_at = Timer::GetTicks();
 		ret = module->Init();
+		module_startup_ms[it - list_modules.begin()] += Timer::TicksToMs(Timer::GetTicks() - started_at);
 	}
 
 	// After all Init calls we call Start() in all modules
@@ -60,8 +71,13 @@ bool Application::Init()
 	for (auto it = list_modules.begin(); it != list_modules.end() && ret; ++it)
 	{
 		Module* module = *it;
+		uint64 started_at = Timer::GetTicks();
 		ret = module->Start();
+		module_startup_ms[it - list_modules.begin()] += Timer::TicksToMs(Timer::GetTicks() - started_at);
 	}
+
+	LOG("Application started in %.3f ms", startup_time.ReadMs());
+	ptimer.Start();
 	
 	return ret;
 }
@@ -71,12 +87,19 @@ update_status Application::Update()
 {
 	update_status ret = UPDATE_CONTINUE;
 
+	profiler.BeginFrame(frame_count);
+
+	// Textures and sounds decoded in the background are created here, on the main thread
+	assets.Update();
+
 	for (auto it = list_modules.begin(); it != list_modules.end() && ret == UPDATE_CONTINUE; ++it)
 	{
 		Module* module = *it;
 		if (module->IsEnabled())
 		{
+			uint64 started_at = Timer::GetTicks();
 			ret = module->PreUpdate();
+			profiler.AddModuleTime((int)(it - list_modules.begin()), PROFILE_PRE_UPDATE, Timer::GetTicks() - started_at);
 		}
 	}
 
@@ -85,7 +108,9 @@ update_status Application::Update()
 		Module* module = *it;
 		if (module->IsEnabled())
 		{
+			uint64 started_at = Timer::GetTicks();
 			ret = module->Update();
+			profiler.AddModuleTime((int)(it - list_modules.begin()), PROFILE_UPDATE, Timer::GetTicks() - started_at);
 		}
 	}
 
@@ -94,11 +119,31 @@ update_status Application::Update()
 		Module* module = *it;
 		if (module->IsEnabled())
 		{
+			uint64 started_at = Timer::GetTicks();
 			ret = module->PostUpdate();
+			profiler.AddModuleTime((int)(it - list_modules.begin()), PROFILE_POST_UPDATE, Timer::GetTicks() - started_at);
 		}
 	}
 
-	if (WindowShouldClose()) ret = UPDATE_STOP;
+	profiler.SetPhysicsProfile(physics->GetFrameProfile(), physics->GetFrameSteps());
+	profiler.EndFrame();
+
+	if (frame_count == 0)
+		LogStartupReport();
+
+	if (startup_assets_pending && assets.IsIdle())
+	{
+		LOG("Startup: %u background assets ready after %.3f ms (frame %llu)", assets.GetLoadedCount(), startup_time.ReadMs(), (unsigned long long)frame_count);
+		startup_assets_pending = false;
+	}
+
+	if (ret == UPDATE_CONTINUE) frame_count++;
+
+	if (headless)
+	{
+		if (max_frames > 0 && frame_count >= max_frames) ret = UPDATE_STOP;
+	}
+	else if (WindowShouldClose()) ret = UPDATE_STOP;
 
 	return ret;
 }
@@ -106,16 +151,58 @@ update_status Application::Update()
 bool Application::CleanUp()
 {
 	bool ret = true;
+	double run_seconds = ptimer.ReadSec();
+
+	// No callbacks into modules that are being cleaned up
+	assets.Stop();
+
 	for (auto it = list_modules.rbegin(); it != list_modules.rend() && ret; ++it)
 	{
 		Module* item = *it;
 		ret = item->CleanUp();
 	}
+
+	if (headless)
+	{
+		// A frame runs as many world steps as the physics rate fits in it
+		uint64 steps = physics->GetStepsTaken();
+		double frames_per_sec = (run_seconds > 0.0) ? (double)frame_count / run_seconds : 0.0;
+		double steps_per_sec = (run_seconds > 0.0) ? (double)steps / run_seconds : 0.0;
+		printf("Headless run: %llu frames, %llu physics steps in %.3f s (%.1f frames/s, %.1f steps/s)\n",
+			(unsigned long long)frame_count, (unsigned long long)steps, run_seconds, frames_per_sec, steps_per_sec);
+	}
 	
 	return ret;
 }
 
-void Application::AddModule(Module* mod)
+bool Application::IsHeadless() const
+{
+	return headless;
+}
+
+uint64 Application::GetFrameCount() const
+{
+	return frame_count;
+}
+
+float Application::GetDeltaTime() const
+{
+	return input->GetDeltaTime();
+}
+
+void Application::AddModule(Module* mod, const char* name)
 {
 	list_modules.emplace_back(mod);
+	module_names.push_back(name);
+	module_startup_ms.push_back(0.0);
+	profiler.AddModule(name);
+}
+
+// Time to first frame and what each module spent on it
+void Application::LogStartupReport() const
+{
+	for (uint i = 0; i < list_modules.size(); ++i)
+		LOG("Startup: %-10s Init + Start %8.3f ms", module_names[i], module_startup_ms[i]);
+
+	LOG("Startup: first frame after %.3f ms, %.0f%% of the assets loaded", startup_time.ReadMs(), assets.GetProgress() * 100.0f);
 }
\ No newline at end of file
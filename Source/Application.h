@@ -2,10 +2,13 @@
 
 #include "Globals.h"
 #include "Timer.h"
+#include "Profiler.h"
+#include "AssetLoader.h"
 #include <vector>
 
 class Module;
 class ModuleWindow;
+class ModuleInput;
 class ModuleRender;
 class ModuleAudio;
 class ModulePhysics;
@@ -17,13 +20,20 @@ public:
 
 	ModuleRender* renderer;
 	ModuleWindow* window;
+	ModuleInput* input;
 	ModuleAudio* audio;
 	ModulePhysics* physics;
 	ModuleGame* scene_intro;
 
+	Profiler profiler;
+	AssetLoader assets;
+
 private:
 
 	std::vector<Module*> list_modules;
+	std::vector<const char*> module_names;
+	std::vector<double> module_startup_ms;	// Init + Start of each module
+	bool startup_assets_pending = true;
     uint64 frame_count = 0;
 
 	Timer ptimer;
@@ -34,16 +44,25 @@ private:
 	uint32 last_sec_frame_count = 0;
 	uint32 prev_last_sec_frame_count = 0;
 
+	// Headless run: no window or GL context, modules are stepped for max_frames
+	bool headless = false;
+	uint64 max_frames = 0;
+
 public:
 
-	Application();
+	Application(bool headless = false, uint64 max_frames = 0);
 	~Application();
 
 	bool Init();
 	update_status Update();
 	bool CleanUp();
 
+	bool IsHeadless() const;
+	uint64 GetFrameCount() const;
+	float GetDeltaTime() const;
+
 private:
 
-	void AddModule(Module* module);
+	void AddModule(Module* module, const char* name);
+	void LogStartupReport() const;
 };
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "AssetLoader.h"
+
+AssetLoader::AssetLoader() : running(false), requested(0), loaded(0)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+	Stop();
+}
+
+void AssetLoader::Start(uint count)
+{
+	if (running)
+		return;
+
+	if (count == 0)
+	{
+		uint hardware = std::thread::hardware_concurrency();
+		count = (hardware > 1) ? hardware - 1 : 1;
+	}
+
+	count = MIN(count, (uint)ASSET_LOADER_MAX_WORKERS);
+	running = true;
+
+	for (uint i = 0; i < count; ++i)
+		workers.push_back(std::thread(&AssetLoader::WorkerLoop, this));
+
+	LOG("Asset loader started with %u workers", count);
+}
+
+void AssetLoader::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+
+	// Nobody will take these anymore
+	for (Job& job : finished)
+	{
+		if (job.type == JOB_IMAGE) UnloadImage(job.image);
+		else UnloadWave(job.wave);
+	}
+
+	pending.clear();
+	finished.clear();
+}
+
+void AssetLoader::LoadImageAsync(const char* path, ImageCallback callback)
+{
+	Job job;
+	job.type = JOB_IMAGE;
+	job.path = path;
+	job.on_image = callback;
+	job.image = Image{};
+	job.wave = Wave{};
+
+	Push(job);
+}
+
+void AssetLoader::LoadWaveAsync(const char* path, WaveCallback callback)
+{
+	Job job;
+	job.type = JOB_WAVE;
+	job.path = path;
+	job.on_wave = callback;
+	job.image = Image{};
+	job.wave = Wave{};
+
+	Push(job);
+}
+
+void AssetLoader::Push(Job& job)
+{
+	requested++;
+
+	if (workers.empty())
+	{
+		Decode(job);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.push_back(std::move(job));
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.push_back(std::move(job));
+	}
+	wake.notify_one();
+}
+
+uint AssetLoader::Update()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (finished.empty())
+			return 0;
+
+		delivering.swap(finished);
+	}
+
+	uint count = (uint)delivering.size();
+
+	for (Job& job : delivering)
+	{
+		if (job.type == JOB_IMAGE)
+		{
+			if (job.image.data == NULL) LOG("Cannot load image: %s", job.path.c_str());
+			job.on_image(job.image);
+			UnloadImage(job.image);
+		}
+		else
+		{
+			if (job.wave.data == NULL) LOG("Cannot load sound: %s", job.path.c_str());
+			job.on_wave(job.wave);
+			UnloadWave(job.wave);
+		}
+	}
+
+	delivering.clear();
+	loaded += count;
+
+	return count;
+}
+
+float AssetLoader::GetProgress() const
+{
+	uint total = requested;
+	return (total == 0) ? 1.0f : (float)loaded / (float)total;
+}
+
+bool AssetLoader::IsIdle() const
+{
+	return loaded == requested;
+}
+
+uint AssetLoader::GetLoadedCount() const
+{
+	return loaded;
+}
+
+void AssetLoader::WorkerLoop()
+{
+	while (true)
+	{
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return running == false || pending.empty() == false; });
+
+			if (running == false)
+				return;
+
+			job = std::move(pending.front());
+			pending.pop_front();
+		}
+
+		Decode(job);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.push_back(std::move(job));
+	}
+}
+
+// File reading and decoding only, raylib keeps no global state for these
+void AssetLoader::Decode(Job& job)
+{
+	if (job.type == JOB_IMAGE)
+		job.image = LoadImage(job.path.c_str());
+	else
+		job.wave = LoadWave(job.path.c_str());
+}
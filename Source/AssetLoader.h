@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define ASSET_LOADER_MAX_WORKERS 4
+
+// Reads and decodes images and sounds on worker threads. Whatever needs the GL
+// context or the audio device (LoadTextureFromImage, LoadSoundFromWave) is left
+// to the callbacks, which run on the main thread inside Update
+class AssetLoader
+{
+public:
+
+	// The decoded data is freed after the callback returns, data is NULL if loading failed
+	typedef std::function<void(const Image& image)> ImageCallback;
+	typedef std::function<void(const Wave& wave)> WaveCallback;
+
+	AssetLoader();
+	~AssetLoader();
+
+	// workers = 0 uses one less than the hardware threads, up to ASSET_LOADER_MAX_WORKERS
+	void Start(uint workers = 0);
+	// Joins the workers, requests not handed to their callback yet are dropped
+	void Stop();
+
+	// Without workers the file is decoded right away, the callback still waits for Update
+	void LoadImageAsync(const char* path, ImageCallback callback);
+	void LoadWaveAsync(const char* path, WaveCallback callback);
+
+	// Main thread, calls the callbacks of finished requests. Returns how many
+	uint Update();
+
+	// Finished requests over requested ones, 1 when there is nothing to load
+	float GetProgress() const;
+	bool IsIdle() const;
+	uint GetLoadedCount() const;
+
+private:
+
+	enum JobType { JOB_IMAGE, JOB_WAVE };
+
+	struct Job
+	{
+		JobType type;
+		std::string path;
+		ImageCallback on_image;
+		WaveCallback on_wave;
+		Image image;
+		Wave wave;
+	};
+
+	void Push(Job& job);
+	void WorkerLoop();
+	static void Decode(Job& job);
+
+private:
+
+	std::vector<std::thread> workers;
+	bool running;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job> pending;
+	std::vector<Job> finished;
+	std::vector<Job> delivering;	// main thread only, swapped with finished
+
+	std::atomic<uint> requested;
+	std::atomic<uint> loaded;
+};
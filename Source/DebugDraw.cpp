@@ -0,0 +1,278 @@
+#include "DebugDraw.h"
+#include "ModulePhysics.h"
+#include "rlgl.h"
+
+#include <math.h>
+
+static const b2Color CIRCLE_COLOR(0.0f, 0.0f, 0.0f, 0.5f);
+static const b2Color POLYGON_COLOR(0.9f, 0.16f, 0.22f);
+static const b2Color CHAIN_COLOR(0.0f, 0.89f, 0.19f);
+static const b2Color EDGE_COLOR(0.0f, 0.47f, 0.95f);
+static const b2Color CONTACT_COLOR(1.0f, 0.95f, 0.0f);
+
+DebugDraw::DebugDraw()
+{
+	target = &lines;
+	static_dirty = true;
+	static_count = 0;
+	line_count = 0;
+	view = Rectangle{ 0.0f, 0.0f, 0.0f, 0.0f };
+
+	SetFlags(e_jointBit);
+}
+
+void DebugDraw::Draw(b2World* world, Rectangle visible)
+{
+	view = visible;
+	target = &lines;
+
+	int statics = 0;
+
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		if (b->GetType() == b2_staticBody)
+		{
+			statics++;
+			continue;
+		}
+
+		if (b->IsEnabled() == false)
+			continue;
+
+		const b2Transform& xf = b->GetTransform();
+		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+		{
+			if (IsVisible(f->GetAABB(0)))
+				DrawFixture(f, xf);
+		}
+	}
+
+	if (static_dirty || statics != static_count)
+	{
+		BuildStatic(world);
+		static_count = statics;
+	}
+
+	// Joints and AABBs through b2World, shapes are drawn above
+	world->DebugDraw();
+
+	for (b2Contact* c = world->GetContactList(); c; c = c->GetNext())
+	{
+		if (c->IsTouching() == false)
+			continue;
+
+		b2WorldManifold manifold;
+		c->GetWorldManifold(&manifold);
+
+		for (int32 i = 0; i < c->GetManifold()->pointCount; ++i)
+			DrawPoint(manifold.points[i], DEBUG_POINT_SIZE, CONTACT_COLOR);
+	}
+
+	Flush();
+}
+
+void DebugDraw::InvalidateStatic()
+{
+	static_dirty = true;
+}
+
+void DebugDraw::SetShowAABBs(bool show)
+{
+	if (show) AppendFlags(e_aabbBit);
+	else ClearFlags(e_aabbBit);
+}
+
+bool DebugDraw::GetShowAABBs() const
+{
+	return (GetFlags() & e_aabbBit) != 0;
+}
+
+uint DebugDraw::GetLineCount() const
+{
+	return line_count;
+}
+
+// Same shapes the old per-fixture switch drew, now as buffered lines
+void DebugDraw::DrawFixture(const b2Fixture* fixture, const b2Transform& xf)
+{
+	switch (fixture->GetType())
+	{
+	case b2Shape::e_circle:
+	{
+		const b2CircleShape* shape = (const b2CircleShape*)fixture->GetShape();
+		DrawSolidCircle(b2Mul(xf, shape->m_p), shape->m_radius, xf.q.GetXAxis(), CIRCLE_COLOR);
+	}
+	break;
+
+	case b2Shape::e_polygon:
+	{
+		const b2PolygonShape* shape = (const b2PolygonShape*)fixture->GetShape();
+		b2Vec2 vertices[b2_maxPolygonVertices];
+
+		for (int32 i = 0; i < shape->m_count; ++i)
+			vertices[i] = b2Mul(xf, shape->m_vertices[i]);
+
+		DrawPolygon(vertices, shape->m_count, POLYGON_COLOR);
+	}
+	break;
+
+	case b2Shape::e_chain:
+	{
+		const b2ChainShape* shape = (const b2ChainShape*)fixture->GetShape();
+		b2Vec2 prev = b2Mul(xf, shape->m_vertices[0]);
+
+		for (int32 i = 1; i < shape->m_count; ++i)
+		{
+			b2Vec2 v = b2Mul(xf, shape->m_vertices[i]);
+			DrawSegment(prev, v, CHAIN_COLOR);
+			prev = v;
+		}
+	}
+	break;
+
+	case b2Shape::e_edge:
+	{
+		const b2EdgeShape* shape = (const b2EdgeShape*)fixture->GetShape();
+		DrawSegment(b2Mul(xf, shape->m_vertex1), b2Mul(xf, shape->m_vertex2), EDGE_COLOR);
+	}
+	break;
+
+	default:
+		break;
+	}
+}
+
+void DebugDraw::BuildStatic(b2World* world)
+{
+	static_lines.clear();
+	target = &static_lines;
+
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		if (b->GetType() != b2_staticBody)
+			continue;
+
+		const b2Transform& xf = b->GetTransform();
+		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+			DrawFixture(f, xf);
+	}
+
+	target = &lines;
+	static_dirty = false;
+}
+
+void DebugDraw::AddLine(const b2Vec2& a, const b2Vec2& b, const b2Color& color)
+{
+	Line line;
+	line.a = Vector2{ PIXELS_PER_METER * a.x, PIXELS_PER_METER * a.y };
+	line.b = Vector2{ PIXELS_PER_METER * b.x, PIXELS_PER_METER * b.y };
+	line.color = Color{ (uchar)(color.r * 255.0f), (uchar)(color.g * 255.0f), (uchar)(color.b * 255.0f), (uchar)(color.a * 255.0f) };
+
+	target->push_back(line);
+}
+
+bool DebugDraw::IsVisible(const b2AABB& aabb) const
+{
+	return PIXELS_PER_METER * aabb.upperBound.x >= view.x && PIXELS_PER_METER * aabb.lowerBound.x <= view.x + view.width &&
+		PIXELS_PER_METER * aabb.upperBound.y >= view.y && PIXELS_PER_METER * aabb.lowerBound.y <= view.y + view.height;
+}
+
+bool DebugDraw::IsVisible(const Line& line) const
+{
+	return fmaxf(line.a.x, line.b.x) >= view.x && fminf(line.a.x, line.b.x) <= view.x + view.width &&
+		fmaxf(line.a.y, line.b.y) >= view.y && fminf(line.a.y, line.b.y) <= view.y + view.height;
+}
+
+// One RL_LINES batch, rlgl only splits it when its vertex buffer is full
+void DebugDraw::Flush()
+{
+	line_count = 0;
+
+	rlBegin(RL_LINES);
+
+	for (const Line& line : static_lines)
+	{
+		if (IsVisible(line) == false)
+			continue;
+
+		rlColor4ub(line.color.r, line.color.g, line.color.b, line.color.a);
+		rlVertex2f(line.a.x, line.a.y);
+		rlVertex2f(line.b.x, line.b.y);
+		line_count++;
+	}
+
+	for (const Line& line : lines)
+	{
+		rlColor4ub(line.color.r, line.color.g, line.color.b, line.color.a);
+		rlVertex2f(line.a.x, line.a.y);
+		rlVertex2f(line.b.x, line.b.y);
+	}
+
+	rlEnd();
+
+	line_count += (uint)lines.size();
+	lines.clear();
+}
+
+// b2Draw ---------------------------------------------------------------------
+
+void DebugDraw::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	b2Vec2 prev = vertices[vertexCount - 1];
+
+	for (int32 i = 0; i < vertexCount; ++i)
+	{
+		AddLine(prev, vertices[i], color);
+		prev = vertices[i];
+	}
+}
+
+void DebugDraw::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	DrawPolygon(vertices, vertexCount, color);
+}
+
+void DebugDraw::DrawCircle(const b2Vec2& center, float radius, const b2Color& color)
+{
+	const float increment = 2.0f * b2_pi / DEBUG_CIRCLE_SEGMENTS;
+	float sin_inc = sinf(increment);
+	float cos_inc = cosf(increment);
+
+	// Rotate the radius vector instead of calling sin/cos per segment
+	b2Vec2 r(radius, 0.0f);
+	b2Vec2 prev = center + r;
+
+	for (int i = 0; i < DEBUG_CIRCLE_SEGMENTS; ++i)
+	{
+		r.Set(cos_inc * r.x - sin_inc * r.y, sin_inc * r.x + cos_inc * r.y);
+		b2Vec2 v = center + r;
+		AddLine(prev, v, color);
+		prev = v;
+	}
+}
+
+void DebugDraw::DrawSolidCircle(const b2Vec2& center, float radius, const b2Vec2& axis, const b2Color& color)
+{
+	DrawCircle(center, radius, color);
+	AddLine(center, center + radius * axis, color);
+}
+
+void DebugDraw::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color)
+{
+	AddLine(p1, p2, color);
+}
+
+void DebugDraw::DrawTransform(const b2Transform& xf)
+{
+	const float axis_scale = 0.4f;
+	AddLine(xf.p, xf.p + axis_scale * xf.q.GetXAxis(), b2Color(1.0f, 0.0f, 0.0f));
+	AddLine(xf.p, xf.p + axis_scale * xf.q.GetYAxis(), b2Color(0.0f, 1.0f, 0.0f));
+}
+
+// A cross size pixels wide
+void DebugDraw::DrawPoint(const b2Vec2& p, float size, const b2Color& color)
+{
+	float h = 0.5f * size / PIXELS_PER_METER;
+	AddLine(b2Vec2(p.x - h, p.y), b2Vec2(p.x + h, p.y), color);
+	AddLine(b2Vec2(p.x, p.y - h), b2Vec2(p.x, p.y + h), color);
+}
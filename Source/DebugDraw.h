@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// Suppress: Variable is uninitialized (C26495) for third-party Box2D types
+#pragma warning(disable : 26495)
+#endif
+#include "box2d\box2d.h"
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#define DEBUG_CIRCLE_SEGMENTS	16
+#define DEBUG_POINT_SIZE		4.0f
+
+// Box2D debug view: everything is turned into line segments that are sent
+// to rlgl in one RL_LINES batch. Static bodies never move so their segments
+// are transformed once and kept until a static body is added or removed
+class DebugDraw : public b2Draw
+{
+public:
+
+	DebugDraw();
+
+	// Shapes, joints and contact points of world inside view (in pixels),
+	// world must have this set with SetDebugDraw
+	void Draw(b2World* world, Rectangle view);
+
+	// Rebuild the static geometry next frame, for static bodies moved with SetTransform
+	void InvalidateStatic();
+
+	void SetShowAABBs(bool show);
+	bool GetShowAABBs() const;
+
+	uint GetLineCount() const;
+
+	// b2Draw ---
+	void DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) override;
+	void DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) override;
+	void DrawCircle(const b2Vec2& center, float radius, const b2Color& color) override;
+	void DrawSolidCircle(const b2Vec2& center, float radius, const b2Vec2& axis, const b2Color& color) override;
+	void DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color) override;
+	void DrawTransform(const b2Transform& xf) override;
+	void DrawPoint(const b2Vec2& p, float size, const b2Color& color) override;
+
+private:
+
+	struct Line
+	{
+		Vector2 a;
+		Vector2 b;
+		Color color;
+	};
+
+	void DrawFixture(const b2Fixture* fixture, const b2Transform& xf);
+	void BuildStatic(b2World* world);
+	void AddLine(const b2Vec2& a, const b2Vec2& b, const b2Color& color);
+	bool IsVisible(const b2AABB& aabb) const;
+	bool IsVisible(const Line& line) const;
+	void Flush();
+
+private:
+
+	std::vector<Line> lines;
+	std::vector<Line> static_lines;
+	std::vector<Line>* target;
+
+	bool static_dirty;
+	int static_count;
+	uint line_count;
+
+	Rectangle view;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <vector>
+
+#define ENTITY_INVALID 0xFFFFFFFF
+
+// Refers to an entity of an EntityPool, it stops being alive once the entity
+// is despawned even if its slot is reused by a later Spawn
+struct EntityHandle
+{
+	uint index = ENTITY_INVALID;
+	uint generation = 0;
+};
+
+// Keeps entities of one type packed in a contiguous array so a whole type is
+// updated in one pass. Despawning moves the last entity into the hole and the
+// handle slot goes to a free list to be recycled by the next Spawn
+template <class T>
+class EntityPool
+{
+public:
+
+	EntityHandle Spawn(const T& entity)
+	{
+		uint slot;
+
+		if (free_slots.empty() == false)
+		{
+			slot = free_slots.back();
+			free_slots.pop_back();
+		}
+		else
+		{
+			slot = (uint)slots.size();
+			slots.push_back(Slot());
+		}
+
+		slots[slot].dense = (uint)items.size();
+		items.push_back(entity);
+		owners.push_back(slot);
+
+		EntityHandle handle;
+		handle.index = slot;
+		handle.generation = slots[slot].generation;
+		return handle;
+	}
+
+	bool Despawn(EntityHandle handle)
+	{
+		if (IsAlive(handle) == false)
+			return false;
+
+		DespawnAt(slots[handle.index].dense);
+		return true;
+	}
+
+	// Despawns the i-th entity of the packed array, the last one takes its place
+	// so iterate backwards when despawning inside a loop
+	void DespawnAt(uint i)
+	{
+		uint slot = owners[i];
+		uint last = (uint)items.size() - 1;
+
+		if (i != last)
+		{
+			items[i] = items[last];
+			owners[i] = owners[last];
+			slots[owners[i]].dense = i;
+		}
+
+		items.pop_back();
+		owners.pop_back();
+
+		slots[slot].dense = ENTITY_INVALID;
+		slots[slot].generation++;
+		free_slots.push_back(slot);
+	}
+
+	void Clear()
+	{
+		while (items.empty() == false)
+			DespawnAt((uint)items.size() - 1);
+	}
+
+	void Reserve(uint count)
+	{
+		items.reserve(count);
+		owners.reserve(count);
+		slots.reserve(count);
+	}
+
+	bool IsAlive(EntityHandle handle) const
+	{
+		return handle.index < slots.size() &&
+			slots[handle.index].generation == handle.generation &&
+			slots[handle.index].dense != ENTITY_INVALID;
+	}
+
+	T* Get(EntityHandle handle)
+	{
+		return IsAlive(handle) ? &items[slots[handle.index].dense] : nullptr;
+	}
+
+	uint Count() const { return (uint)items.size(); }
+	T& operator[](uint i) { return items[i]; }
+	const T& operator[](uint i) const { return items[i]; }
+
+private:
+
+	struct Slot
+	{
+		uint dense = ENTITY_INVALID;
+		uint generation = 0;
+	};
+
+	std::vector<T> items;
+	std::vector<uint> owners;	// slot of each packed entity
+	std::vector<Slot> slots;
+	std::vector<uint> free_slots;
+};
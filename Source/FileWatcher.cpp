@@ -0,0 +1,52 @@
+#include "FileWatcher.h"
+
+FileWatcher::FileWatcher(float interval) : interval(interval), timer(0.0f)
+{
+}
+
+void FileWatcher::Add(const char* path)
+{
+	for (const Watch& watch : files)
+	{
+		if (watch.path == path)
+			return;
+	}
+
+	Watch watch;
+	watch.path = path;
+	watch.modified = FileExists(path) ? GetFileModTime(path) : 0;
+	files.push_back(watch);
+}
+
+void FileWatcher::Clear()
+{
+	files.clear();
+	timer = 0.0f;
+}
+
+uint FileWatcher::Poll(float dt, std::vector<std::string>& changed)
+{
+	changed.clear();
+
+	timer += dt;
+	if (timer < interval)
+		return 0;
+
+	timer = 0.0f;
+
+	for (Watch& watch : files)
+	{
+		// Editors may delete and write the file again, wait until it is back
+		if (FileExists(watch.path.c_str()) == false)
+			continue;
+
+		long modified = GetFileModTime(watch.path.c_str());
+		if (modified != watch.modified)
+		{
+			watch.modified = modified;
+			changed.push_back(watch.path);
+		}
+	}
+
+	return (uint)changed.size();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <string>
+#include <vector>
+
+#define FILE_WATCH_INTERVAL 0.5f
+
+// Notices when files are modified by polling their modification time, at most
+// once per interval so it can be called every frame
+class FileWatcher
+{
+public:
+
+	FileWatcher(float interval = FILE_WATCH_INTERVAL);
+
+	void Add(const char* path);
+	void Clear();
+
+	// Fills changed with the files modified since the previous check, dt is the frame time
+	uint Poll(float dt, std::vector<std::string>& changed);
+
+private:
+
+	struct Watch
+	{
+		std::string path;
+		long modified;
+	};
+
+	std::vector<Watch> files;
+	float interval;
+	float timer;
+};
@@ -38,4 +38,8 @@ enum update_status
 #define WIN_BORDERLESS		false
 #define WIN_FULLSCREEN_DESKTOP false
 #define VSYNC				true
+#define HEADLESS_FRAMES		10000
+#define FRAME_RATE			60
+#define PHYSICS_RATE		60
+#define MAX_FRAME_TIME		0.25f
 #define TITLE "Physics 2D Playground"
\ No newline at end of file
@@ -1,16 +1,247 @@
 #pragma once
 
 #include "Globals.h"
+#include "Log.h"
+#include "Timer.h"
+
+#include <stdarg.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// Bounded multi-producer / single-consumer queue: producers claim a cell with
+// one CAS on enqueue_pos, the writer thread owns dequeue_pos
+struct LogRecord
+{
+	std::atomic<size_t> sequence;
+	const char* file;
+	int line;
+	uint64 ticks;
+	char message[LOG_MESSAGE_SIZE];
+};
+
+static LogRecord log_records[LOG_QUEUE_SIZE];
+static std::atomic<size_t> enqueue_pos(0);
+static size_t dequeue_pos = 0;
+static std::atomic<bool> log_queue_ready(false);
+
+static std::atomic<uint64> log_dropped(0);
+static uint64 log_dropped_reported = 0;
+
+static std::thread log_thread;
+static std::atomic<bool> log_running(false);
+
+static const char* log_path = NULL;
+static FILE* log_file = NULL;
+static long log_file_size = 0;
+static uint64 log_started_at = 0;
+
+static void LogQueueInit()
+{
+	// Only the first caller initializes, callers racing with it drop their record
+	static std::atomic<int> state(0);
+	int expected = 0;
+
+	if (state.compare_exchange_strong(expected, 1))
+	{
+		for (size_t i = 0; i < LOG_QUEUE_SIZE; ++i)
+			log_records[i].sequence.store(i, std::memory_order_relaxed);
+
+		log_started_at = Timer::GetTicks();
+		log_queue_ready.store(true, std::memory_order_release);
+	}
+}
 
 void log(const char file[], int line, const char* format, ...)
 {
-	static char tmp_string[4096];
-	static char tmp_string2[4096];
-	static va_list  ap;
+	if (log_queue_ready.load(std::memory_order_acquire) == false)
+	{
+		LogQueueInit();
+
+		if (log_queue_ready.load(std::memory_order_acquire) == false)
+		{
+			log_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	LogRecord* record = NULL;
+	size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		record = &log_records[pos & (LOG_QUEUE_SIZE - 1)];
+		size_t sequence = record->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
 
-	// Construct the string from variable arguments
+		if (diff == 0)
+		{
+			if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			// Queue full: never stall the caller
+			log_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else
+		{
+			pos = enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	record->file = file;
+	record->line = line;
+	record->ticks = Timer::GetTicks();
+
+	// va_list cannot outlive this call, so the message itself is formatted here
+	va_list ap;
 	va_start(ap, format);
-	vsprintf_s(tmp_string, 4096, format, ap);
+	vsnprintf(record->message, LOG_MESSAGE_SIZE, format, ap);
 	va_end(ap);
-	sprintf_s(tmp_string2, 4096, "\n%s(%d) : %s", file, line, tmp_string);
-}
\ No newline at end of file
+
+	record->sequence.store(pos + 1, std::memory_order_release);
+}
+
+// Writer thread ---------------------------------------------------------------
+static void LogRotate()
+{
+	if (log_file != NULL)
+		fclose(log_file);
+
+	char from[512], to[512];
+	snprintf(to, sizeof(to), "%s.%d", log_path, LOG_MAX_BACKUPS);
+	remove(to);
+
+	for (int i = LOG_MAX_BACKUPS - 1; i >= 1; --i)
+	{
+		snprintf(from, sizeof(from), "%s.%d", log_path, i);
+		snprintf(to, sizeof(to), "%s.%d", log_path, i + 1);
+		rename(from, to);
+	}
+
+	snprintf(to, sizeof(to), "%s.1", log_path);
+	rename(log_path, to);
+
+	if (fopen_s(&log_file, log_path, "w") != 0)
+		log_file = NULL;
+
+	log_file_size = 0;
+}
+
+static void LogWrite(const char* text, int length)
+{
+	if (log_path == NULL)
+	{
+		fwrite(text, 1, length, stdout);
+		return;
+	}
+
+	if (log_file == NULL)
+		return;
+
+	if (log_file_size + length > LOG_MAX_FILE_SIZE)
+		LogRotate();
+
+	if (log_file != NULL)
+	{
+		fwrite(text, 1, length, log_file);
+		log_file_size += length;
+	}
+}
+
+// Formats and writes every record ready in the queue, returns how many
+static int LogFlush()
+{
+	char buffer[LOG_MESSAGE_SIZE + 512];
+	int written = 0;
+
+	for (;;)
+	{
+		LogRecord* record = &log_records[dequeue_pos & (LOG_QUEUE_SIZE - 1)];
+
+		if (record->sequence.load(std::memory_order_acquire) != dequeue_pos + 1)
+			break;
+
+		double ms = Timer::TicksToMs(record->ticks - log_started_at);
+		int length = snprintf(buffer, sizeof(buffer), "[%10.3f] %s(%d) : %s\n", ms, record->file, record->line, record->message);
+
+		record->sequence.store(dequeue_pos + LOG_QUEUE_SIZE, std::memory_order_release);
+		dequeue_pos++;
+
+		if (length > (int)sizeof(buffer) - 1) length = (int)sizeof(buffer) - 1;
+		if (length > 0) LogWrite(buffer, length);
+		written++;
+	}
+
+	uint64 dropped = log_dropped.load(std::memory_order_relaxed);
+	if (dropped != log_dropped_reported)
+	{
+		int length = snprintf(buffer, sizeof(buffer), "[log] %llu records dropped, queue full\n", (unsigned long long)(dropped - log_dropped_reported));
+		LogWrite(buffer, length);
+		log_dropped_reported = dropped;
+	}
+
+	if (written > 0)
+	{
+		if (log_file != NULL) fflush(log_file);
+		else if (log_path == NULL) fflush(stdout);
+	}
+
+	return written;
+}
+
+static void LogThread()
+{
+	while (log_running.load(std::memory_order_acquire))
+	{
+		if (LogFlush() == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	LogFlush();
+}
+
+bool LogStart(const char* path)
+{
+	if (log_running.load())
+		return true;
+
+	LogQueueInit();
+
+	log_path = path;
+	if (log_path != NULL)
+	{
+		if (fopen_s(&log_file, log_path, "w") != 0 || log_file == NULL)
+		{
+			log_file = NULL;
+			log_path = NULL;
+			LOG("Cannot open log file %s, logging to stdout", path);
+		}
+	}
+
+	log_running.store(true, std::memory_order_release);
+	log_thread = std::thread(LogThread);
+
+	return log_file != NULL || path == NULL;
+}
+
+void LogStop()
+{
+	if (log_running.exchange(false) == false)
+		return;
+
+	log_thread.join();
+
+	if (log_file != NULL)
+	{
+		fclose(log_file);
+		log_file = NULL;
+	}
+}
+
+uint64 LogDroppedCount()
+{
+	return log_dropped.load(std::memory_order_relaxed);
+}
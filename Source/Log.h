@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Globals.h"
+
+#define LOG_QUEUE_SIZE		1024	// Must be a power of two
+#define LOG_MESSAGE_SIZE	256
+#define LOG_MAX_FILE_SIZE	(1024 * 1024)
+#define LOG_MAX_BACKUPS		3
+
+// Starts the background writer thread. Records go to stdout when path is NULL,
+// otherwise to path, rotated to path.1 .. path.LOG_MAX_BACKUPS when it grows too big
+bool LogStart(const char* path = NULL);
+
+// Writes every queued record and stops the writer thread
+void LogStop();
+
+// Records lost because the queue was full
+uint64 LogDroppedCount();
@@ -1,9 +1,15 @@
 #include "Application.h"
 #include "Globals.h"
+#include "Log.h"
+#include "ModulePhysics.h"
+#include "ModuleInput.h"
+#include "ModuleGame.h"
 
 #include "raylib.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 
 enum main_states
 {
@@ -18,7 +24,83 @@ int main(int argc, char ** argv)
 {
 	LOG("Starting game '%s'...", TITLE);
 
-	SetTargetFPS(60);
+	// --headless [frames]: step the game without window or renderer as fast as possible
+	// --physics-hz <rate>: fixed physics step rate
+	// --fps <rate>: render frame rate cap, 0 to uncap
+	// --record <file> / --replay <file>: write or play back a binary input log
+	// --profile-csv <file>: dump the frame profiler ring buffer on exit
+	// --log-file <file>: write the log to a rotating file instead of stdout
+	// --table <file>: table description to play, compiled to <file>.bin on first load
+	// --hot-reload: reload the table and its textures when their files change
+	// --physics-threads <n>: run the physics narrow phase and islands on n threads, 0 for all hardware threads
+	bool headless = false;
+	bool headless_frames_set = false;
+	uint64 headless_frames = HEADLESS_FRAMES;
+	const char* record_path = NULL;
+	const char* replay_path = NULL;
+	const char* profile_path = NULL;
+	const char* log_path = NULL;
+	const char* table_path = NULL;
+	bool hot_reload = false;
+	int physics_threads = -1;
+	float physics_rate = PHYSICS_RATE;
+	int frame_rate = FRAME_RATE;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+			if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+			{
+				headless_frames = strtoull(argv[++i], NULL, 10);
+				headless_frames_set = true;
+			}
+		}
+		else if (strcmp(argv[i], "--physics-hz") == 0 && i + 1 < argc)
+		{
+			physics_rate = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+		{
+			frame_rate = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			record_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replay_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc)
+		{
+			profile_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--log-file") == 0 && i + 1 < argc)
+		{
+			log_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--table") == 0 && i + 1 < argc)
+		{
+			table_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--hot-reload") == 0)
+		{
+			hot_reload = true;
+		}
+		else if (strcmp(argv[i], "--physics-threads") == 0 && i + 1 < argc)
+		{
+			physics_threads = atoi(argv[++i]);
+		}
+	}
+
+	LogStart(log_path);
+
+	// A replay runs until its log ends unless a frame count is given
+	if (replay_path != NULL && headless_frames_set == false) headless_frames = 0;
+
+	if (headless == false) SetTargetFPS(frame_rate);
 
 	int main_return = EXIT_FAILURE;
 	main_states state = MAIN_CREATION;
@@ -31,7 +113,13 @@ int main(int argc, char ** argv)
 		case MAIN_CREATION:
 
 			LOG("-------------- Application Creation --------------");
-			App = new Application();
+			App = new Application(headless, headless_frames);
+			App->physics->SetStepRate(physics_rate);
+			if (physics_threads >= 0) App->physics->SetWorkerThreads((uint)physics_threads);
+			App->input->SetRecordPath(record_path);
+			App->input->SetReplayPath(replay_path);
+			App->scene_intro->SetTablePath(table_path);
+			App->scene_intro->SetHotReload(hot_reload);
 			state = MAIN_START;
 			break;
 
@@ -68,6 +156,8 @@ int main(int argc, char ** argv)
 
 		case MAIN_FINISH:
 
+			if (profile_path != NULL) App->profiler.DumpCSV(profile_path);
+
 			LOG("-------------- Application CleanUp --------------");
 			if (App->CleanUp() == false)
 			{
@@ -85,5 +175,7 @@ int main(int argc, char ** argv)
 
 	delete App;
 	LOG("Exiting game '%s'...\n", TITLE);
+	LogStop();
+
 	return main_return;
 }
\ No newline at end of file
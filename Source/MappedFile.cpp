@@ -0,0 +1,108 @@
+#include "MappedFile.h"
+
+// No raylib in here, windows.h declares functions with the same names
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = NULL;
+	size = 0;
+	file = NULL;
+	mapping = NULL;
+	fd = -1;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	file = handle;
+
+	LARGE_INTEGER file_size;
+	if (GetFileSizeEx(handle, &file_size) == FALSE || file_size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	data = MapViewOfFile((HANDLE)mapping, FILE_MAP_READ, 0, 0, 0);
+	size = (size_t)file_size.QuadPart;
+#else
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	data = (view == MAP_FAILED) ? NULL : view;
+	size = (size_t)info.st_size;
+#endif
+
+	if (data == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != NULL) UnmapViewOfFile(data);
+	if (mapping != NULL) CloseHandle((HANDLE)mapping);
+	if (file != NULL) CloseHandle((HANDLE)file);
+#else
+	if (data != NULL) munmap((void*)data, size);
+	if (fd >= 0) close(fd);
+#endif
+
+	data = NULL;
+	size = 0;
+	file = NULL;
+	mapping = NULL;
+	fd = -1;
+}
+
+const void* MappedFile::GetData() const
+{
+	return data;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return size;
+}
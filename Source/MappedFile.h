@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+
+// Read only view of a whole file mapped in memory. The pages are loaded by the
+// OS when they are first touched, nothing is copied on Open
+class MappedFile
+{
+public:
+
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* path);
+	void Close();
+
+	const void* GetData() const;
+	size_t GetSize() const;
+
+private:
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+
+	const void* data;
+	size_t size;
+
+	// Win32 file and mapping handles, or the descriptor on other platforms
+	void* file;
+	void* mapping;
+	int fd;
+};
@@ -72,7 +72,27 @@ public:
 		return true; 
 	}
 
-	virtual void OnCollision(PhysBody* bodyA, PhysBody* bodyB)
+	// Called after the physics step in which bodyA started touching bodyB,
+	// impulse is the largest normal impulse of the contact in that step
+	virtual void OnCollision(PhysBody* bodyA, PhysBody* bodyB, float impulse)
+	{
+	}
+
+	virtual void OnCollisionEnd(PhysBody* bodyA, PhysBody* bodyB)
+	{
+	}
+
+	// Called before every fixed physics step, dt is the step length in seconds
+	virtual void OnPhysicsStep(float dt)
+	{
+	}
+
+	// State stored along every physics snapshot, up to size bytes
+	virtual void OnSaveSnapshot(uchar* data, uint size)
+	{
+	}
+
+	virtual void OnRestoreSnapshot(const uchar* data, uint size)
 	{
 	}
 };
\ No newline at end of file
@@ -4,12 +4,34 @@
 
 #include "raylib.h"
 
-#define MAX_FX_SOUNDS   64
+#include <chrono>
+#include <ctype.h>
 
 ModuleAudio::ModuleAudio(Application* app, bool start_enabled) : Module(app, start_enabled)
 {
 	fx_count = 0;
+	voice_fx_count = 0;
 	music = Music{ 0 };
+	playing_music = Music{ 0 };
+	running = false;
+
+	for (Effect& effect : fx)
+	{
+		effect.refs = 0;
+		effect.loads = 0;
+		effect.loaded = false;
+		effect.sound = Sound{};
+		effect.max_instances = FX_MAX_INSTANCES;
+		effect.priority = 0;
+
+		for (Voice& voice : effect.voices)
+			voice = Voice{};
+	}
+
+	trigger_count = 0;
+	frame_triggers = 0;
+	voices_stolen = 0;
+	voices_dropped = 0;
 
 	flipperHitFx = 0;
 	bumperHitFx = 0;
@@ -25,6 +47,10 @@ ModuleAudio::ModuleAudio(Application* app, bool start_enabled) : Module(app, sta
 // Destructor
 ModuleAudio::~ModuleAudio()
 {
+	// CleanUp is skipped when Start fails, a running std::thread would abort here
+	running = false;
+	if (audio_thread.joinable())
+		audio_thread.join();
 }
 
 
@@ -38,13 +64,21 @@ bool ModuleAudio::Init()
 
 	InitAudioDevice();
 
+	running = true;
+	audio_thread = std::thread(&ModuleAudio::AudioThread, this);
+
 	// Load pinball SFX
 	flipperHitFx = LoadFx("assets/audio/flipper_hit.wav");
 	bumperHitFx = LoadFx("assets/audio/bumper_hit.wav");
 	ballLostFx = LoadFx("assets/audio/ball_lost.wav");
-	bonusFx = LoadFx("assets/audio/bonus.wav");
+	bonusFx = LoadFx("Assets/bonus.wav");
 	comboCompleteFx = LoadFx("assets/audio/combo_complete.wav");
 
+	// Hits may pile up, the rest must always be heard
+	SetFxLimits(ballLostFx, 1, 2);
+	SetFxLimits(bonusFx, 2, 1);
+	SetFxLimits(comboCompleteFx, 1, 1);
+
 	PlayMusic("assets/audio/pinball_theme.wav");
 
 	return ret;
@@ -52,10 +86,8 @@ bool ModuleAudio::Init()
 
 update_status ModuleAudio::Update()
 {
-	if (music.stream.buffer != NULL)
-	{
-		UpdateMusicStream(music);
-	}
+	// The music is refilled on the audio thread
+	frame_triggers = 0;
 
 	return UPDATE_CONTINUE;
 }
@@ -65,17 +97,26 @@ bool ModuleAudio::CleanUp()
 {
 	LOG("Freeing sound FX, closing Mixer and Audio subsystem");
 
-	// Unload sounds
+	running = false;
+	if (audio_thread.joinable())
+		audio_thread.join();
+
+	// Whatever the audio thread left in the queue, so nothing leaks
+	AudioCommand command;
+	while (commands.Pop(command))
+		Execute(command);
+
+	LOG("Sound FX: %llu played, %llu voices stolen, %llu dropped", (unsigned long long)trigger_count, (unsigned long long)voices_stolen.load(), (unsigned long long)voices_dropped.load());
+
+	// Unload sounds still referenced
 	for (unsigned int i = 0; i < fx_count; i++)
-	{
-		UnloadSound(fx[i]);
-	}
+		FreeEffect(fx[i]);
 
 	// Unload music
-	if (music.stream.buffer != NULL)
+	if (playing_music.stream.buffer != NULL)
 	{
-		StopMusicStream(music);
-		UnloadMusicStream(music);
+		StopMusicStream(playing_music);
+		UnloadMusicStream(playing_music);
 	}
 
 	CloseAudioDevice();
@@ -91,13 +132,30 @@ bool ModuleAudio::PlayMusic(const char* path, float fade_time)
 
 	bool ret = true;
 
-	StopMusicStream(music);
-	music = LoadMusicStream(path);
+	std::string key = NormalizePath(path);
+
+	AudioCommand command = {};
+
+	// Same file: keep the stream, restart it only if it stopped
+	if (music.stream.buffer != NULL && key == music_path)
+	{
+		command.type = AUDIO_RESUME_MUSIC;
+		return Send(command);
+	}
+
+	// Opening the file stays here, the audio thread unloads the previous stream
+	Music loaded = LoadMusicStream(path);
 
-	if (music.stream.buffer != NULL)
+	if (loaded.stream.buffer != NULL)
 	{
-		::SetMusicVolume(music, musicVolume * masterVolume);
-		PlayMusicStream(music);
+		music = loaded;
+		music_path = key;
+
+		command.type = AUDIO_PLAY_MUSIC;
+		command.music = loaded;
+		command.volume = musicVolume * masterVolume;
+		Send(command);
+
 		LOG("Successfully playing %s", path);
 	}
 	else
@@ -106,52 +164,367 @@ bool ModuleAudio::PlayMusic(const char* path, float fade_time)
 		ret = false;
 	}
 
-	LOG("Successfully playing %s", path);
-
 	return ret;
 }
 
-// Load WAV
+// Load WAV in the background, the id is valid right away and plays nothing
+// until the sound arrives
 unsigned int ModuleAudio::LoadFx(const char* path)
 {
 	if (IsEnabled() == false)
 		return 0;
 
-	unsigned int ret = 0;
+	std::string key = NormalizePath(path);
+	unsigned int id = 0;
 
-	Sound sound = LoadSound(path);
+	for (unsigned int i = 0; i < fx_count; ++i)
+	{
+		if (fx[i].refs > 0 && fx[i].path == key)
+		{
+			fx[i].refs++;
+			return i + 1;
+		}
+
+		if (fx[i].refs == 0 && id == 0)
+			id = i + 1;
+	}
 
-	if (sound.stream.buffer == NULL)
+	if (id == 0)
 	{
-		LOG("Cannot load sound: %s", path);
+		if (fx_count >= MAX_SOUNDS)
+		{
+			LOG("Cannot load sound: %s, all %d slots are used", path, MAX_SOUNDS);
+			return 0;
+		}
+
+		id = ++fx_count;
 	}
-	else
+
+	Effect& effect = fx[id - 1];
+	unsigned int loads = ++effect.loads;
+	effect.path = key;
+	effect.refs = 1;
+	effect.loaded = false;
+
+	// raylib converts the samples to the device format here, playing them only mixes
+	App->assets.LoadWaveAsync(path, [this, id, loads](const Wave& wave)
+	{
+		Effect& loaded = fx[id - 1];
+
+		if (wave.data == NULL || loaded.loads != loads)
+			return;
+
+		AudioCommand command = {};
+		command.type = AUDIO_FX_LOADED;
+		command.fx = id;
+		command.sound = LoadSoundFromWave(wave);
+
+		if (command.sound.stream.buffer != NULL && Send(command))
+			loaded.loaded = true;
+	});
+
+	return id;
+}
+
+void ModuleAudio::UnloadFx(unsigned int id)
+{
+	if (id == 0 || id > fx_count || fx[id - 1].refs == 0)
+		return;
+
+	Effect& effect = fx[id - 1];
+
+	if (--effect.refs == 0)
 	{
-		fx[fx_count++] = sound;
-		ret = fx_count;
+		effect.path.clear();
+		effect.loaded = false;
+
+		AudioCommand command = {};
+		command.type = AUDIO_FX_FREE;
+		command.fx = id;
+		Send(command);
 	}
+}
 
-	return ret;
+// Aliases first, they point to the samples of the sound
+void ModuleAudio::FreeEffect(Effect& effect)
+{
+	for (Voice& voice : effect.voices)
+	{
+		if (voice.sound.stream.buffer != NULL)
+			UnloadSoundAlias(voice.sound);
+
+		voice = Voice{};
+	}
+
+	if (effect.sound.stream.buffer != NULL)
+		UnloadSound(effect.sound);
+
+	effect.sound = Sound{};
+	effect.max_instances = FX_MAX_INSTANCES;
+	effect.priority = 0;
+}
+
+// Files are found the same whatever the case or separators used to name them
+std::string ModuleAudio::NormalizePath(const char* path)
+{
+	std::string key;
+
+	for (const char* c = path; *c != '\0'; ++c)
+	{
+		if (*c == '\\' || *c == '/')
+		{
+			if (key.empty() == false && key.back() == '/')
+				continue;
+
+			key += '/';
+		}
+		else
+		{
+			key += (char)tolower((unsigned char)*c);
+		}
+	}
+
+	while (key.compare(0, 2, "./") == 0)
+		key.erase(0, 2);
+
+	return key;
+}
+
+void ModuleAudio::SetFxLimits(unsigned int id, unsigned int max_instances, int priority)
+{
+	if (id == 0 || id > fx_count || fx[id - 1].refs == 0)
+		return;
+
+	AudioCommand command = {};
+	command.type = AUDIO_FX_LIMITS;
+	command.fx = id;
+	command.max_instances = (max_instances < 1) ? 1 : (max_instances > FX_MAX_INSTANCES) ? FX_MAX_INSTANCES : max_instances;
+	command.priority = priority;
+	Send(command);
 }
 
 // Play WAV
 bool ModuleAudio::PlayFx(unsigned int id, int repeat)
 {
-	if (IsEnabled() == false)
+	return TriggerFx(id, 1.0f, 1.0f);
+}
+
+bool ModuleAudio::TriggerFx(unsigned int id, float pitch, float volume)
+{
+	if (IsEnabled() == false || id == 0 || id > fx_count || fx[id - 1].refs == 0)
+		return false;
+
+	// Still loading or failed to load
+	if (fx[id - 1].loaded == false)
+		return false;
+
+	// Multiball pile-ups trigger dozens of hits in the same step
+	if (frame_triggers >= MAX_TRIGGERS_PER_FRAME)
 	{
+		voices_dropped++;
 		return false;
 	}
 
-	bool ret = false;
+	AudioCommand command = {};
+	command.type = AUDIO_PLAY_FX;
+	command.fx = id;
+	command.pitch = pitch;
+	command.volume = volume * sfxVolume * masterVolume;
 
-	if (id > 0 && id <= fx_count)
+	// A sound that does not fit is not worth a stall
+	if (Send(command, false) == false)
 	{
-		SetSoundVolume(fx[id - 1], sfxVolume * masterVolume);
-		PlaySound(fx[id - 1]);
-		ret = true;
+		voices_dropped++;
+		return false;
 	}
 
-	return ret;
+	frame_triggers++;
+	return true;
+}
+
+bool ModuleAudio::Send(const AudioCommand& command, bool wait)
+{
+	while (commands.Push(command) == false)
+	{
+		// Only while starting or closing, nobody is draining the queue
+		if (running == false)
+		{
+			Execute(command);
+			return true;
+		}
+
+		if (wait == false)
+			return false;
+
+		std::this_thread::yield();
+	}
+
+	return true;
+}
+
+void ModuleAudio::AudioThread()
+{
+	AudioCommand command;
+
+	while (running)
+	{
+		while (commands.Pop(command))
+			Execute(command);
+
+		if (playing_music.stream.buffer != NULL)
+			UpdateMusicStream(playing_music);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_THREAD_PERIOD));
+	}
+}
+
+void ModuleAudio::Execute(const AudioCommand& command)
+{
+	switch (command.type)
+	{
+	case AUDIO_PLAY_FX:
+		PlayVoice(command.fx, command.pitch, command.volume);
+		break;
+
+	case AUDIO_FX_LIMITS:
+		fx[command.fx - 1].max_instances = command.max_instances;
+		fx[command.fx - 1].priority = command.priority;
+		break;
+
+	case AUDIO_FX_LOADED:
+	{
+		Effect& effect = fx[command.fx - 1];
+		effect.sound = command.sound;
+
+		if (command.fx > voice_fx_count)
+			voice_fx_count = command.fx;
+
+		for (Voice& voice : effect.voices)
+			voice.sound = LoadSoundAlias(effect.sound);
+		break;
+	}
+
+	case AUDIO_FX_FREE:
+		FreeEffect(fx[command.fx - 1]);
+		break;
+
+	case AUDIO_PLAY_MUSIC:
+		if (playing_music.stream.buffer != NULL)
+		{
+			StopMusicStream(playing_music);
+			UnloadMusicStream(playing_music);
+		}
+
+		playing_music = command.music;
+		::SetMusicVolume(playing_music, command.volume);
+		PlayMusicStream(playing_music);
+		break;
+
+	case AUDIO_RESUME_MUSIC:
+		if (playing_music.stream.buffer != NULL && IsMusicStreamPlaying(playing_music) == false)
+		{
+			SeekMusicStream(playing_music, 0.0f);
+			PlayMusicStream(playing_music);
+		}
+		break;
+
+	case AUDIO_MUSIC_VOLUME:
+		if (playing_music.stream.buffer != NULL)
+			::SetMusicVolume(playing_music, command.volume);
+		break;
+
+	case AUDIO_MASTER_VOLUME:
+		::SetMasterVolume(command.volume);
+		break;
+	}
+}
+
+// Starts a voice of the effect: an idle one, or the oldest one of the effect
+// once it reaches its instance cap
+void ModuleAudio::PlayVoice(unsigned int id, float pitch, float volume)
+{
+	Effect& effect = fx[id - 1];
+
+	// Freed before the command arrived
+	if (effect.sound.stream.buffer == NULL)
+		return;
+
+	Voice* voice = nullptr;
+	Voice* oldest = nullptr;
+
+	for (unsigned int i = 0; i < effect.max_instances; ++i)
+	{
+		Voice& candidate = effect.voices[i];
+
+		if (IsSoundPlaying(candidate.sound))
+		{
+			if (oldest == nullptr || candidate.started < oldest->started)
+				oldest = &candidate;
+		}
+		else if (voice == nullptr)
+		{
+			voice = &candidate;
+		}
+	}
+
+	if (voice == nullptr)
+	{
+		voice = oldest;
+		StopSound(voice->sound);
+		voices_stolen++;
+	}
+	else
+	{
+		unsigned int active = 0;
+		Voice* victim = FindVictim(effect.priority, active);
+
+		if (active >= MAX_ACTIVE_VOICES)
+		{
+			if (victim == nullptr)
+			{
+				voices_dropped++;
+				return;
+			}
+
+			StopSound(victim->sound);
+			voices_stolen++;
+		}
+	}
+
+	SetSoundPitch(voice->sound, pitch);
+	SetSoundVolume(voice->sound, volume);
+	PlaySound(voice->sound);
+
+	voice->started = ++trigger_count;
+}
+
+// Counts the playing voices and picks the one to stop when the mixer is full:
+// lowest priority first, then the oldest, never above priority
+ModuleAudio::Voice* ModuleAudio::FindVictim(int priority, unsigned int& active)
+{
+	Voice* victim = nullptr;
+	int victim_priority = priority;
+
+	// fx_count belongs to the main thread, only loaded slots have voices
+	for (unsigned int i = 0; i < voice_fx_count; ++i)
+	{
+		for (Voice& voice : fx[i].voices)
+		{
+			if (IsSoundPlaying(voice.sound) == false)
+				continue;
+
+			active++;
+
+			if (fx[i].priority < victim_priority ||
+				(fx[i].priority == victim_priority && (victim == nullptr || voice.started < victim->started)))
+			{
+				victim = &voice;
+				victim_priority = fx[i].priority;
+			}
+		}
+	}
+
+	return victim;
 }
 
 void ModuleAudio::PlayFlipperHit(float impactForce)
@@ -181,34 +554,22 @@ void ModuleAudio::PlayBallLost()
 
 void ModuleAudio::PlayFxWithPitch(unsigned int id, float pitch)
 {
-	if (IsEnabled() == false || id == 0 || id > fx_count)
-		return;
-
 	if (pitch < 0.1f) pitch = 0.1f;
 	if (pitch > 2.0f) pitch = 2.0f;
 
-	SetSoundPitch(fx[id - 1], pitch);
-	PlayFx(id);
-	SetSoundPitch(fx[id - 1], 1.0f);
+	TriggerFx(id, pitch, 1.0f);
 }
 
 void ModuleAudio::PlayFxWithVolume(unsigned int id, float volume)
 {
-	if (IsEnabled() == false || id == 0 || id > fx_count)
-		return;
-
 	if (volume < 0.0f) volume = 0.0f;
 	if (volume > 1.0f) volume = 1.0f;
 
-	SetSoundVolume(fx[id - 1], volume * sfxVolume * masterVolume);
-	PlaySound(fx[id - 1]);
+	TriggerFx(id, 1.0f, volume);
 }
 
 void ModuleAudio::PlayFxWithVariation(unsigned int id, float impactForce)
 {
-	if (IsEnabled() == false || id == 0 || id > fx_count)
-		return;
-
 	if (impactForce < 0.0f) impactForce = 0.0f;
 	if (impactForce > 1.0f) impactForce = 1.0f;
 
@@ -218,11 +579,8 @@ void ModuleAudio::PlayFxWithVariation(unsigned int id, float impactForce)
 	// Vary volume: 0.6 to 1.0 based on impact
 	float volume = 0.6f + (impactForce * 0.4f);
 
-	SetSoundPitch(fx[id - 1], pitch);
-	SetSoundVolume(fx[id - 1], volume * sfxVolume * masterVolume);
-	PlaySound(fx[id - 1]);
-
-	SetSoundPitch(fx[id - 1], 1.0f);
+	// Each voice keeps its own pitch, nothing to restore afterwards
+	TriggerFx(id, pitch, volume);
 }
 
 void ModuleAudio::SetMasterVolume(float volume)
@@ -231,12 +589,15 @@ void ModuleAudio::SetMasterVolume(float volume)
 	if (volume > 1.0f) volume = 1.0f;
 
 	masterVolume = volume;
-	::SetMasterVolume(masterVolume);
 
-	if (music.stream.buffer != NULL)
-	{
-		::SetMusicVolume(music, musicVolume * masterVolume);
-	}
+	AudioCommand command = {};
+	command.type = AUDIO_MASTER_VOLUME;
+	command.volume = masterVolume;
+	Send(command);
+
+	command.type = AUDIO_MUSIC_VOLUME;
+	command.volume = musicVolume * masterVolume;
+	Send(command);
 }
 
 void ModuleAudio::SetSFXVolume(float volume)
@@ -254,10 +615,10 @@ void ModuleAudio::SetMusicVolume(float volume)
 
 	musicVolume = volume;
 
-	if (music.stream.buffer != NULL)
-	{
-		::SetMusicVolume(music, musicVolume * masterVolume);
-	}
+	AudioCommand command = {};
+	command.type = AUDIO_MUSIC_VOLUME;
+	command.volume = musicVolume * masterVolume;
+	Send(command);
 }
 
 bool IsMusicValid(Music music)
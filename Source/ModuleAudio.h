@@ -1,11 +1,23 @@
 #pragma once
 
 #include "Module.h"
+#include "SpscQueue.h"
 #include "raylib.h"
 
+#include <atomic>
+#include <string>
+#include <thread>
+
 #define MAX_SOUNDS	16
+#define FX_MAX_INSTANCES		4	// voices (sound aliases) of one effect
+#define MAX_ACTIVE_VOICES		16	// voices mixed at once
+#define MAX_TRIGGERS_PER_FRAME	8	// sounds started per frame, the rest are dropped
 #define DEFAULT_MUSIC_FADE_TIME 2.0f
+#define AUDIO_QUEUE_SIZE		256	// commands waiting for the audio thread
+#define AUDIO_THREAD_PERIOD		4	// ms between music refills on the audio thread
 
+// Music streaming and sound playback run on an audio thread, the API queues
+// commands for it so a slow frame does not starve the music stream
 class ModuleAudio : public Module
 {
 public:
@@ -20,12 +32,19 @@ public:
 	// Play a music file
 	bool PlayMusic(const char* path, float fade_time = DEFAULT_MUSIC_FADE_TIME);
 
-	// Load a sound in memory
+	// Load a sound in memory, loading the same file again returns the same id
 	unsigned int LoadFx(const char* path);
+	// Releases one load of the sound, it is unloaded with the last one
+	void UnloadFx(unsigned int fx);
 
 	// Play a previously loaded sound
 	bool PlayFx(unsigned int fx, int repeat = 0);
 
+	// Voices of fx that may play at once (up to FX_MAX_INSTANCES) and its
+	// priority: a full mixer stops the oldest voice with the lowest priority
+	// not above it, or drops the new sound if there is none
+	void SetFxLimits(unsigned int fx, unsigned int max_instances, int priority);
+
 	void PlayFlipperHit(float impactForce = 0.5f);
 	void PlayBumperHit(float impactForce = 0.5f);
 	void PlayBonusSound();
@@ -47,11 +66,82 @@ public:
 	float GetMusicVolume() const { return musicVolume; }
 private:
 
+	enum AudioCommandType
+	{
+		AUDIO_PLAY_FX,
+		AUDIO_FX_LIMITS,
+		AUDIO_FX_LOADED,
+		AUDIO_FX_FREE,
+		AUDIO_PLAY_MUSIC,
+		AUDIO_RESUME_MUSIC,
+		AUDIO_MUSIC_VOLUME,
+		AUDIO_MASTER_VOLUME
+	};
+
+	struct AudioCommand
+	{
+		AudioCommandType type;
+		unsigned int fx;
+		float pitch;
+		float volume;
+		int priority;		// AUDIO_FX_LIMITS, with max_instances
+		unsigned int max_instances;
+		Sound sound;		// AUDIO_FX_LOADED
+		Music music;		// AUDIO_PLAY_MUSIC
+	};
+
+	// Each voice has its own buffer, pitch and volume, sharing the effect's samples
+	struct Voice
+	{
+		Sound sound;
+		uint64 started;	// trigger order, the oldest voice is stolen first
+	};
+
+	struct Effect
+	{
+		// Main thread
+		std::string path;	// normalized, empty when the slot is free
+		unsigned int refs;
+		unsigned int loads;	// discards sounds arriving for an older use of the slot
+		bool loaded;
+
+		// Audio thread
+		Sound sound;
+		Voice voices[FX_MAX_INSTANCES];
+		unsigned int max_instances;
+		int priority;
+	};
+
+	// Main thread. Commands that must not be lost wait for room in the queue
+	bool Send(const AudioCommand& command, bool wait = true);
+	bool TriggerFx(unsigned int fx, float pitch, float volume);
+
+	// Audio thread, or the main thread once the audio thread is gone
+	void AudioThread();
+	void Execute(const AudioCommand& command);
+	void PlayVoice(unsigned int fx, float pitch, float volume);
+	Voice* FindVictim(int priority, unsigned int& active);
+	void FreeEffect(Effect& effect);
+
+	static std::string NormalizePath(const char* path);
+
+	Effect fx[MAX_SOUNDS];
+	unsigned int fx_count;		// main thread, slots handed out by LoadFx
+	unsigned int voice_fx_count;	// audio thread, slots up to the highest loaded sound
+
+	// Main thread copy of the music loaded last, the audio thread owns the stream
 	Music music;
-	Sound fx[MAX_SOUNDS];
-	unsigned int fx_count;
+	std::string music_path;
+	Music playing_music;
 
+	SpscQueue<AudioCommand, AUDIO_QUEUE_SIZE> commands;
+	std::thread audio_thread;
+	std::atomic<bool> running;
 
+	unsigned int frame_triggers;
+	uint64 trigger_count;
+	std::atomic<uint64> voices_stolen;
+	std::atomic<uint64> voices_dropped;
 
 	unsigned int flipperHitFx;
 	unsigned int bumperHitFx;
@@ -1,112 +1,53 @@
 #include "Globals.h"
 #include "Application.h"
 #include "ModuleRender.h"
+#include "ModuleInput.h"
 #include "ModuleGame.h"
 #include "ModuleAudio.h"
 #include "ModulePhysics.h"
 
-constexpr float PALA_SCALE = 0.25f;
-
-class PhysicEntity
-{
-protected:
-
-	PhysicEntity(PhysBody* _body, Module* _listener)
-		: body(_body)
-		, listener(_listener)
-	{
-		body->listener = listener;
-	}
-
-public:
-	virtual ~PhysicEntity() = default;
-	virtual void Update() = 0;
-
-	virtual int RayHit(vec2<int> ray, vec2<int> mouse, vec2<float>& normal)
-	{
-		return 0;
-	}
-
-protected:
-	PhysBody* body;
-	Module* listener;
-};
-
-class Circle : public PhysicEntity
-{
-public:
-	Circle(ModulePhysics* physics, int _x, int _y, Module* _listener, Texture2D _texture)
-		: PhysicEntity(physics->CreateCircle(_x, _y, 9), _listener)//radio de colision de la pelota
-		, texture(_texture)
-	{
-
-	}
-
-	void Update() override
-	{
-		int x, y;
-		body->GetPhysicPosition(x, y);
-		Vector2 position{ (float)x, (float)y };
-		float desired_radius = 9.0f;
-
-		// Calcula la escala para que el ancho de la textura coincida con el di�metro f�sico
-		float scale = (desired_radius * 2.0f) / (float)texture.width;
-
-		Rectangle source = { 0.0f, 0.0f, (float)texture.width, (float)texture.height };
-		Rectangle dest = { position.x, position.y, (float)texture.width * scale, (float)texture.height * scale };
-		Vector2 origin = { (float)texture.width * scale / 2.0f, (float)texture.height * scale / 2.0f };
-		float rotation = body->GetRotation() * RAD2DEG;
-
-		DrawTexturePro(texture, source, dest, origin, rotation, WHITE);
-	}
-
-private:
-	Texture2D texture;
+#include <string.h>
+#include <algorithm>
 
+constexpr float PALA_SCALE = 0.25f;
+constexpr float GOALKEEPER_SCALE = 0.15f;
+
+// Sprite batch layers, lower layers are drawn first
+constexpr int LAYER_TABLE = 0;
+constexpr int LAYER_CRATES = 1;
+constexpr int LAYER_BALLS = 2;
+
+// Small sprites packed in the texture atlas, the backgrounds stay on their own
+static const char* const atlas_sprites[] = {
+	"Assets/ball0001.png",
+	"Assets/crate.png",
+	"Assets/goalkeeper.png",
+	"Assets/boardL2.png",
+	"Assets/boardR2.png"
 };
+constexpr int ATLAS_SPRITE_COUNT = sizeof(atlas_sprites) / sizeof(atlas_sprites[0]);
 
-class Box : public PhysicEntity
-{
-public:
-	Box(ModulePhysics* physics, int _x, int _y, Module* _listener, Texture2D _texture)
-		: PhysicEntity(physics->CreateRectangle(_x, _y, 100, 50), _listener)
-		, texture(_texture)
-	{
-
-	}
-
-	void Update() override
-	{
-		int x, y;
-		body->GetPhysicPosition(x, y);
-		DrawTexturePro(texture, Rectangle{ 0, 0, (float)texture.width, (float)texture.height },
-			Rectangle{ (float)x, (float)y, (float)texture.width, (float)texture.height },
-			Vector2{ (float)texture.width / 2.0f, (float)texture.height / 2.0f}, body->GetRotation() * RAD2DEG, WHITE);
-	}
-
-	int RayHit(vec2<int> ray, vec2<int> mouse, vec2<float>& normal) override
-	{
-		return body->RayCast(ray.x, ray.y, mouse.x, mouse.y, normal.x, normal.y);;
-	}
+constexpr const char* FONDO_PATH = "Assets/game_back2.png";
+constexpr const char* MENU_PATH = "Assets/menu_back.png";
 
-private:
-	Texture2D texture;
-
-};
+constexpr const char* DEFAULT_TABLE = "Assets/table.txt";
 
+// Normal impulse (N*s) of a ball hit that plays its sound at full volume
+constexpr float FULL_HIT_IMPULSE = 1.0f;
 
 ModuleGame::ModuleGame(Application* app, bool start_enabled) : Module(app, start_enabled)
 {	
 	sensed = false;
-	resetPending = false;
 	gameStarted = false;
 	score = 0;
 	lives = 3;
-	ignoreCollisionsFrames = 0;
+	ignoreCollisionsTime = 0.0f;
+	table_path = DEFAULT_TABLE;
+	hot_reload = false;
 	
 	// Initialize goalkeeper animation
 	goalkeeperX = SCREEN_WIDTH / 2.0f;
-	baseGoalkeeperSpeed = 1.5f;
+	baseGoalkeeperSpeed = 90.0f;
 	goalkeeperSpeed = baseGoalkeeperSpeed;
 	goalkeeperMovingRight = true;
 	
@@ -124,19 +65,19 @@ bool ModuleGame::Start()
 	bool ret = true;
 
 	App->renderer->camera.x = App->renderer->camera.y = 0;
+	App->physics->AddStepListener(this);
+	App->physics->SetSnapshotListener(this);
 
+	// Las texturas se cargan en segundo plano, el menú sale mientras tanto
 	//creacion de la textura de fondo
-	fondo = LoadTexture("Assets/game_back2.png");
+	App->renderer->LoadTextureAsync(FONDO_PATH, &fondo);
 	
-	//creacion de la textura de la pelota
-	circle = LoadTexture("Assets/ball0001.png"); 
-
-	box = LoadTexture("Assets/crate.png");
+	//creacion de la textura de la pelota, las palas y el portero. Los tamaños
+	//ya valen para crear las palas, la textura se recoge al subirse
+	App->renderer->LoadAtlas(atlas_sprites, ATLAS_SPRITE_COUNT, [this]() { LoadRegions(); });
+	LoadRegions();
 	
-	// Load goalkeeper decoration texture
-	goalkeeper = LoadTexture("Assets/goalkeeper.png");
-	
-	menuTexture = LoadTexture("Assets/menu_back.png"); // asegúrate de tener esta imagen
+	App->renderer->LoadTextureAsync(MENU_PATH, &menuTexture); // asegúrate de tener esta imagen
 	//Load music and sound
 	bonus_fx = App->audio->LoadFx("Assets/bonus.wav");
 	App->audio->PlayMusic("Assets/Music_font.wav");
@@ -145,270 +86,412 @@ bool ModuleGame::Start()
 	circleBody->listener = this;
 	circleBody->body->SetBullet(true);
 	
-	//------------------------------Sistema Puntuación---------------------------------------------//
+	//------------------------------------------MESA-----------------------------------------------//
+	// Sensores, portero, palas y paredes salen del fichero de mesa
+	if (LoadTable() == false)
+		return false;
 
-	// Portería rival (arriba) - suma puntos
-	goalSensor = App->physics->CreateRectangleSensor(SCREEN_WIDTH / 2, 20, 200, 20);
-	goalSensor->listener = this;
+	App->physics->BeginTableBuild();
+	BuildTable();
+	App->physics->EndTableBuild();
 
-	// Portería propia (entre las palancas) - resta vida
-	// Posición: justo debajo y entre las dos palancas
-	ownGoalSensor = App->physics->CreateRectangleSensor(400, 440, 70, 10);
-	ownGoalSensor->listener = this;
+	// Box2D ya tiene su copia de los vértices
+	table.Unload();
+	//------------------------------------------FIN MESA-------------------------------------------//
 
-	// Sensor de caída (fondo) - resta puntos
-	// Ajuste: bajado 25 px respecto al valor anterior
-	// Centro en X, Y=450, ancho toda la mesa, altura 10 px
-	sensor = App->physics->CreateRectangleSensor(SCREEN_WIDTH / 2, 450, SCREEN_WIDTH, 10);
-	sensor->listener = this;
-
-	// Create goalkeeper physics body with proper collision settings
-	goalkeeperBody = App->physics->CreateRectangle((int)goalkeeperX, 35, 50, 70);
-	goalkeeperBody->body->SetType(b2_kinematicBody);
-	goalkeeperBody->listener = this;
-	
-	// Set up the goalkeeper fixture for better collision response
-	b2Fixture* goalkeeperFixture = goalkeeperBody->body->GetFixtureList();
-	if (goalkeeperFixture != nullptr)
+	if (hot_reload)
 	{
-		goalkeeperFixture->SetRestitution(0.8f); // Make it bouncy
-		goalkeeperFixture->SetFriction(0.1f);
-		goalkeeperFixture->SetDensity(1.0f);
+		watcher.Add(table_path.c_str());
+		watcher.Add(FONDO_PATH);
+		watcher.Add(MENU_PATH);
+		for (int i = 0; i < ATLAS_SPRITE_COUNT; ++i)
+			watcher.Add(atlas_sprites[i]);
+
+		LOG("Hot reload enabled for %s and the table textures", table_path.c_str());
 	}
 
-	//-------------------------------CREACION DE COLISIONES DE LAS PALAS---------------------------//
-	pala_right = LoadTexture("Assets/boardR2.png");
-	pala_left = LoadTexture("Assets/boardL2.png");
-	// Tamaños físicos - reducidos 3 píxeles en cada dimensión
-	int ancho_pala = (int)(pala_left.width * PALA_SCALE) - 3;
-	int alto_pala = (int)(pala_left.height * PALA_SCALE) - 3;
-
-	// Pivote izquierdo
-	PhysBody* pivote_L = App->physics->CreateRectangle(340, 395, 5, 5);
-	pivote_L->body->SetType(b2_staticBody);
-
-	// Pala izquierda desplazada
-	int offsetX = (int)(pala_left.width * PALA_SCALE / 2.0f);
-	pala_l = App->physics->CreateRectangle(360, 395, ancho_pala, alto_pala);
-	pala_l->body->SetType(b2_dynamicBody);
-
-	// Junta izquierda
-	b2RevoluteJointDef jointDefL;
-	jointDefL.Initialize(pivote_L->body, pala_l->body, pivote_L->body->GetWorldCenter());
-	jointDefL.enableMotor = true;
-	jointDefL.maxMotorTorque = 1000.0f;
-	jointDefL.motorSpeed = 0.0f;
-	jointDefL.enableLimit = true;
-	jointDefL.lowerAngle = -0.25f * b2_pi;
-	jointDefL.upperAngle = 0.20f * b2_pi;
-	pala_l_joint = App->physics->CreateJoint(&jointDefL);
-
-
-	// Pivote derecho
-	PhysBody* pivote_R = App->physics->CreateRectangle(460, 395, 5, 5);
-	pivote_R->body->SetType(b2_staticBody);
-
-	// Pala derecha
-	pala_r = App->physics->CreateRectangle(438, 395, ancho_pala, alto_pala);
-	pala_r->body->SetType(b2_dynamicBody);
-
-	// Junta derecha
-	b2RevoluteJointDef jointDefR;
-	jointDefR.Initialize(pivote_R->body, pala_r->body, pivote_R->body->GetWorldCenter());
-	jointDefR.enableMotor = true;
-	jointDefR.maxMotorTorque = 1000.0f;
-	jointDefR.motorSpeed = 0.0f;
-	jointDefR.enableLimit = true;
-	jointDefR.lowerAngle = -0.20f * b2_pi;
-	jointDefR.upperAngle = 0.25f * b2_pi;
-	pala_r_joint = App->physics->CreateJoint(&jointDefR);
-	//---------------------------------FIN COLISIONES PALAS-----------------------------------------//
+	return ret;
+}
+
+// Load assets
+bool ModuleGame::CleanUp()
+{
+	LOG("Unloading Intro scene");
+	DespawnEntities();
+	UnloadTexture(menuTexture);
+	App->audio->UnloadFx(bonus_fx);
+	table.Unload();
+	watcher.Clear();
+
+	// ModulePhysics frees the bodies
+	sensor_bodies.clear();
+	chain_bodies.clear();
+	built_sensors.clear();
+	built_chains.clear();
+	return true;
+}
+
+void ModuleGame::SetTablePath(const char* path)
+{
+	if (path != NULL)
+		table_path = path;
+}
+
+void ModuleGame::SetHotReload(bool enable)
+{
+	hot_reload = enable;
+}
+
+void ModuleGame::LoadRegions()
+{
+	circle = App->renderer->GetRegion("Assets/ball0001.png");
+	box = App->renderer->GetRegion("Assets/crate.png");
 	
-	//---------------------------------CREACI�N FISICAS MAPA----------------------------------------//
-
-	int game_back1[20] = {
-	274, 121,
-	303, 142,
-	303, 340,
-	340, 383,
-	331, 398,
-	291, 354,
-	289, 154,
-	267, 140,
-	266, 127,
-	273, 121
-	};
-
-
-	for (int i = 0; i < 20; i++)
+	// Load goalkeeper decoration texture
+	goalkeeper = App->renderer->GetRegion("Assets/goalkeeper.png");
+
+	pala_right = App->renderer->GetRegion("Assets/boardR2.png");
+	pala_left = App->renderer->GetRegion("Assets/boardL2.png");
+}
+
+bool ModuleGame::LoadTable(bool force)
+{
+	std::string compiled = table_path.substr(0, table_path.find_last_of('.')) + ".bin";
+	if (table.Load(table_path.c_str(), compiled.c_str(), force) == false)
 	{
-		PIXEL_TO_METERS(game_back1[i]);
+		LOG("Cannot load table %s", table_path.c_str());
+		return false;
 	}
-	App->physics->CreateChain(0, 0, game_back1, 20);
-
-
-
-	int game_back2[20] = {
-	527, 121,
-	529, 140,
-	507, 152,
-	507, 349,
-	468, 397,
-	460, 391,
-	457, 383,
-	493, 337,
-	491, 142,
-	526, 121
-	};
-	for (int i = 0; i < 20; i++)
-{
-	PIXEL_TO_METERS(game_back2[i]);
+
+	return true;
 }
-	App->physics->CreateChain(0, 0, game_back2, 20);
-
-
-	int game_back3[36] = {
-	500, 35,
-	512, 17,
-	511, 10,
-	287, 10,
-	286, 15,
-	296, 34,
-	275, 35,
-	253, 47,
-	246, 55,
-	240, 70,
-	240, 478,
-	558, 478,
-	558, 118,
-	558, 71,
-	548, 53,
-	535, 41,
-	521, 36,
-	501, 35
-	};
-	for (int i = 0; i < 36; i++)
+
+// Crea los cuerpos de la mesa cargada comparándola con la que se construyó antes:
+// al empezar se crea todo y al recargar solo lo que ha cambiado
+uint ModuleGame::BuildTable()
+{
+	uint rebuilt = 0;
+	const TableHeader& header = table.GetHeader();
+
+	//------------------------------Sistema Puntuación---------------------------------------------//
+	// Portería rival (arriba) suma puntos, portería propia (entre las palancas)
+	// resta vida y el sensor de caída (fondo) resta puntos
+	const TableSensor* sensors = table.GetSensors();
+
+	for (uint i = header.sensor_count; i < sensor_bodies.size(); ++i)
+		App->physics->DestroyBody(sensor_bodies[i]);
+
+	sensor_bodies.resize(header.sensor_count, nullptr);
+	built_sensors.resize(header.sensor_count);
+
+	for (uint i = 0; i < header.sensor_count; ++i)
 	{
-		PIXEL_TO_METERS(game_back3[i]);
+		if (sensor_bodies[i] != nullptr && memcmp(&built_sensors[i], &sensors[i], sizeof(TableSensor)) == 0)
+			continue;
+
+		if (sensor_bodies[i] != nullptr)
+			App->physics->DestroyBody(sensor_bodies[i]);
+
+		const TableRect& rect = sensors[i].rect;
+		sensor_bodies[i] = App->physics->CreateRectangleSensor(rect.x, rect.y, rect.width, rect.height);
+		sensor_bodies[i]->listener = this;
+		built_sensors[i] = sensors[i];
+		rebuilt++;
 	}
-	App->physics->CreateChain(0, 0, game_back3, 36);
-
-	int game_back4[34] = {
-		489, 47,
-		490, 37,
-		498, 19,
-		301, 20,
-		309, 37,
-		311, 47,
-		277, 47,
-		264, 53,
-		255, 59,
-		246, 74,
-		247, 461,
-		551, 463,
-		551, 82,
-		546, 67,
-		537, 55,
-		521, 48,
-		490, 47
-	};
-
-	for (int i = 0; i < 34; i++)
+
+	goalSensor = ownGoalSensor = sensor = nullptr;
+	for (uint i = 0; i < header.sensor_count; ++i)
 	{
-		PIXEL_TO_METERS(game_back4[i]);
+		switch (sensors[i].type)
+		{
+		case TABLE_SENSOR_GOAL: goalSensor = sensor_bodies[i]; break;
+		case TABLE_SENSOR_OWN_GOAL: ownGoalSensor = sensor_bodies[i]; break;
+		case TABLE_SENSOR_DRAIN:
+			sensor = sensor_bodies[i];
+			drain_y = sensors[i].rect.y;
+			break;
+		}
 	}
-	App->physics->CreateChain(0, 0, game_back4, 34);
 
-	int game_back5[10] = {
-	387, 448,
-	411, 448,
-	410, 456,
-	387, 456,
-	387, 449
-	};
+	// Create goalkeeper physics body with proper collision settings
+	const TableGoalkeeper& keeper = header.goalkeeper;
+	goalLeft = (float)keeper.min_x;
+	goalRight = (float)keeper.max_x;
 
-	for (int i = 0; i < 10; i++)
+	if (goalkeeperBody == nullptr || memcmp(&built_header.goalkeeper.rect, &keeper.rect, sizeof(TableRect)) != 0)
 	{
-		PIXEL_TO_METERS(game_back5[i]);
+		if (goalkeeperBody != nullptr)
+			App->physics->DestroyBody(goalkeeperBody);
+
+		goalkeeperX = (float)keeper.rect.x;
+		goalkeeperY = (float)keeper.rect.y;
+
+		goalkeeperBody = App->physics->CreateKinematicRectangle(keeper.rect.x, keeper.rect.y, keeper.rect.width, keeper.rect.height);
+		goalkeeperBody->listener = this;
+	
+		// Set up the goalkeeper fixture for better collision response
+		b2Fixture* goalkeeperFixture = goalkeeperBody->body->GetFixtureList();
+		if (goalkeeperFixture != nullptr)
+		{
+			goalkeeperFixture->SetRestitution(0.8f); // Make it bouncy
+			goalkeeperFixture->SetFriction(0.1f);
+			goalkeeperFixture->SetDensity(1.0f);
+		}
+
+		rebuilt++;
 	}
-	App->physics->CreateChain(0, 0, game_back5, 10);
 
-	//------------------------------------------------FIN FISICA MAPA--------------------------------------------//
-	return ret;
+	//-------------------------------CREACION DE COLISIONES DE LAS PALAS---------------------------//
+	const TableFlipper& left = header.flippers[TABLE_FLIPPER_LEFT];
+	if (pala_l == nullptr || memcmp(&built_header.flippers[TABLE_FLIPPER_LEFT], &left, sizeof(TableFlipper)) != 0)
+	{
+		BuildFlipper(left, pivote_l, pala_l, pala_l_joint);
+		rebuilt++;
+	}
+
+	const TableFlipper& right = header.flippers[TABLE_FLIPPER_RIGHT];
+	if (pala_r == nullptr || memcmp(&built_header.flippers[TABLE_FLIPPER_RIGHT], &right, sizeof(TableFlipper)) != 0)
+	{
+		BuildFlipper(right, pivote_r, pala_r, pala_r_joint);
+		rebuilt++;
+	}
+
+	//---------------------------------CREACIÓN FISICAS MAPA----------------------------------------//
+	const TableChain* chains = table.GetChains();
+
+	for (uint i = header.chain_count; i < chain_bodies.size(); ++i)
+		App->physics->DestroyBody(chain_bodies[i]);
+
+	chain_bodies.resize(header.chain_count, nullptr);
+	built_chains.resize(header.chain_count);
+
+	for (uint i = 0; i < header.chain_count; ++i)
+	{
+		const b2Vec2* vertices = table.GetVertices(chains[i]);
+		std::vector<b2Vec2>& built = built_chains[i];
+
+		if (chain_bodies[i] != nullptr && built.size() == chains[i].count && std::equal(built.begin(), built.end(), vertices))
+			continue;
+
+		if (chain_bodies[i] != nullptr)
+			App->physics->DestroyBody(chain_bodies[i]);
+
+		chain_bodies[i] = App->physics->CreateChain(vertices, (int)chains[i].count);
+		built.assign(vertices, vertices + chains[i].count);
+		rebuilt++;
+	}
+
+	built_header = header;
+	return rebuilt;
 }
 
-// Load assets
-bool ModuleGame::CleanUp()
+void ModuleGame::BuildFlipper(const TableFlipper& flipper, PhysBody*& pivote, PhysBody*& pala, b2RevoluteJoint*& joint)
 {
-	LOG("Unloading Intro scene");
-	UnloadTexture(menuTexture);
-	UnloadTexture(goalkeeper);
-	return true;
+	// La junta se destruye con los cuerpos
+	if (pala != nullptr) App->physics->DestroyBody(pala);
+	if (pivote != nullptr) App->physics->DestroyBody(pivote);
+
+	// Tamaños físicos - reducidos 3 píxeles en cada dimensión
+	int ancho_pala = (int)(pala_left.section.width * PALA_SCALE) - 3;
+	int alto_pala = (int)(pala_left.section.height * PALA_SCALE) - 3;
+
+	pivote = App->physics->CreateStaticRectangle(flipper.pivot_x, flipper.pivot_y, 5, 5);
+	pala = App->physics->CreateRectangle(flipper.x, flipper.y, ancho_pala, alto_pala);
+
+	b2RevoluteJointDef jointDef;
+	jointDef.Initialize(pivote->body, pala->body, pivote->body->GetWorldCenter());
+	jointDef.enableMotor = true;
+	jointDef.maxMotorTorque = 1000.0f;
+	jointDef.motorSpeed = 0.0f;
+	jointDef.enableLimit = true;
+	jointDef.lowerAngle = flipper.lower_angle;
+	jointDef.upperAngle = flipper.upper_angle;
+	joint = App->physics->CreateJoint(&jointDef);
+}
+
+// Watched files that changed are loaded again while the game keeps running
+void ModuleGame::HotReload()
+{
+	if (watcher.Poll(App->GetDeltaTime(), changed_files) == 0)
+		return;
+
+	for (const std::string& path : changed_files)
+	{
+		LOG("Hot reload: %s changed", path.c_str());
+
+		if (path == table_path)
+		{
+			// Si no compila se sigue jugando con la mesa anterior. El .bin puede
+			// tener la misma fecha que el cambio, así que se compila siempre
+			if (LoadTable(true))
+			{
+				LOG("Table reloaded, %u parts rebuilt", BuildTable());
+				table.Unload();
+			}
+		}
+		else if (path == FONDO_PATH)
+		{
+			App->renderer->ReloadTexture(fondo, FONDO_PATH);
+		}
+		else if (path == MENU_PATH)
+		{
+			App->renderer->ReloadTexture(menuTexture, MENU_PATH);
+		}
+		else if (App->renderer->ReloadAtlasSprite(path.c_str()) == false)
+		{
+			// Ha cambiado de tamaño: hay que volver a empaquetar el atlas. La cache
+			// puede tener la misma fecha que el cambio, así que no se mira
+			App->renderer->LoadAtlas(atlas_sprites, ATLAS_SPRITE_COUNT, [this]() { LoadRegions(); }, true);
+			LoadRegions();
+		}
+	}
 }
 
-// Update: draw background
+// Update: game logic, drawing is skipped when running headless
 update_status ModuleGame::Update()
 {
+	if (hot_reload)
+		HotReload();
+
 	if (!gameStarted)
 	{
 		// --- ESTADO DE MENÚ ---
-		DrawTexture(menuTexture, 0, 0, WHITE);
-		DrawText("Presiona ESPACIO para jugar", 200, 400, 30, WHITE);
-
-		if (IsKeyPressed(KEY_SPACE))
+		if (App->input->IsKeyPressed(KEY_SPACE))
 		{
 			gameStarted = true;
 			lives = 3;
 			score = 0;
+			DespawnEntities();
 			ResetBall();
 		}
 
+		if (App->IsHeadless() == false)
+			DrawMenu();
+
 		return UPDATE_CONTINUE;
 	}
 
 	// --- ESTADO DE JUEGO (Solo se ejecuta si gameStarted == true) ---
 
-	// 1. Dibujar el fondo del juego
-	App->renderer->Draw(fondo, 0, 0);
+	//-------------------------------CONTROL DE LAS PALAS-------------------------//
+	// Control pala izquierda
+	if (App->input->IsKeyDown(KEY_LEFT)) {
+		pala_l_joint->SetMotorSpeed(-20.0f);
+	}
+	else {
+		pala_l_joint->SetMotorSpeed(10.0f);
+	}
+
+	// Control pala derecha
+	if (App->input->IsKeyDown(KEY_RIGHT)) {
+		pala_r_joint->SetMotorSpeed(20.0f);
+	}
+	else {
+		pala_r_joint->SetMotorSpeed(-10.0f);
+	}
+	//------------------------------FIN DE LOS CONTROLES PALAS------------------//
+	ray_on = false;
+
+	if (App->IsHeadless() == false)
+		Draw();
 	
-	// Draw the ball
-	if (circleBody != nullptr)
+	// Verificar Game Over
+	if (lives <= 0)
 	{
-		int x, y;
-		circleBody->GetPhysicPosition(x, y);
-		Vector2 position{ (float)x, (float)y };
-		float desired_radius = 9.0f;
+		gameStarted = false;
+		return UPDATE_CONTINUE;
+	}
 
-		// Calculate scale so texture width matches physical diameter
-		float scale = (desired_radius * 2.0f) / (float)circle.width;
+	if(App->input->IsKeyPressed(KEY_SPACE))
+	{
+		ray_on = !ray_on;
+		ray.x = App->input->GetMouseX();
+		ray.y = App->input->GetMouseY();
+	}
 
-		Rectangle source = { 0.0f, 0.0f, (float)circle.width, (float)circle.height };
-		Rectangle dest = { position.x, position.y, (float)circle.width * scale, (float)circle.height * scale };
-		Vector2 origin = { (float)circle.width * scale / 2.0f, (float)circle.height * scale / 2.0f };
-		float rotation = circleBody->GetRotation() * RAD2DEG;
+	if(App->input->IsKeyPressed(KEY_ONE) || App->input->IsKeyPressed(KEY_TWO))
+	{
+		int x = App->input->GetMouseX();
+		int y = App->input->GetMouseY();
 
-		DrawTexturePro(circle, source, dest, origin, rotation, WHITE);
+		// No spawnear dentro de otro cuerpo
+		if (App->physics->QueryPoint(x, y) == nullptr)
+		{
+			if (App->input->IsKeyPressed(KEY_ONE)) SpawnBall(x, y);
+			if (App->input->IsKeyPressed(KEY_TWO)) SpawnCrate(x, y);
+		}
 	}
-	
-	// Draw and animate goalkeeper decoration
-	if (goalkeeper.id != 0) // Check if texture is loaded
+
+	DespawnDrained();
+
+	if (App->IsHeadless() == false)
 	{
-		float scale = 0.15f; // Scale down the goalkeeper
-		float scaledWidth = goalkeeper.width * scale;
-		float scaledHeight = goalkeeper.height * scale;
-		
-		int goalkeeperY = 25; // Near the top goal area
-		
-		// Define goal boundaries (adjust these to match your goal area)
-		float goalLeft = 300.0f;
-		float goalRight = 500.0f;
-		float goalCenter = (goalLeft + goalRight) / 2.0f;
+		DrawEntities();
+		App->renderer->FlushSprites();
+		DrawOverlay();
+	}
+
+	return UPDATE_CONTINUE;
+}
+
+// Lo que cambia con cada paso, para rebobinar junto con los cuerpos
+struct GameSnapshot
+{
+	int score;
+	int lives;
+	float goalkeeperX;
+	bool goalkeeperMovingRight;
+	bool gameStarted;
+	float ignoreCollisionsTime;
+};
+
+void ModuleGame::OnSaveSnapshot(uchar* data, uint size)
+{
+	static_assert(sizeof(GameSnapshot) <= SNAPSHOT_USER_SIZE, "GameSnapshot does not fit in a WorldSnapshot");
+
+	GameSnapshot state;
+	state.score = score;
+	state.lives = lives;
+	state.goalkeeperX = goalkeeperX;
+	state.goalkeeperMovingRight = goalkeeperMovingRight;
+	state.gameStarted = gameStarted;
+	state.ignoreCollisionsTime = ignoreCollisionsTime;
+
+	memcpy(data, &state, sizeof(state));
+}
+
+void ModuleGame::OnRestoreSnapshot(const uchar* data, uint size)
+{
+	GameSnapshot state;
+	memcpy(&state, data, sizeof(state));
+
+	score = state.score;
+	lives = state.lives;
+	goalkeeperX = state.goalkeeperX;
+	goalkeeperMovingRight = state.goalkeeperMovingRight;
+	gameStarted = state.gameStarted;
+	ignoreCollisionsTime = state.ignoreCollisionsTime;
+}
+
+// Advance time based game state, runs once per fixed physics step
+void ModuleGame::OnPhysicsStep(float dt)
+{
+	if (!gameStarted)
+		return;
+
+	// Descontar tiempo de ignorar colisiones
+	if (ignoreCollisionsTime > 0.0f)
+		ignoreCollisionsTime -= dt;
+
+	// Animate goalkeeper movement
+	if (goalkeeper.section.width != 0)
+	{
+		float scaledWidth = goalkeeper.section.width * GOALKEEPER_SCALE;
 		
 		// Calculate speed multiplier: 50% increase per point
 		float speedMultiplier = 1.0f + (score * 0.50f);
-		float currentGoalkeeperSpeed = baseGoalkeeperSpeed * speedMultiplier;
+		float currentGoalkeeperSpeed = baseGoalkeeperSpeed * speedMultiplier * dt;
 		
-		// Animate goalkeeper movement
 		if (goalkeeperMovingRight)
 		{
 			goalkeeperX += currentGoalkeeperSpeed;
@@ -430,127 +513,140 @@ update_status ModuleGame::Update()
 		if (goalkeeperBody != nullptr)
 		{
 			// Position the physics body to match the visual goalkeeper (center of the collision box)
-			b2Vec2 newPos(PIXEL_TO_METERS(goalkeeperX), PIXEL_TO_METERS(35.0f));
+			b2Vec2 newPos(PIXEL_TO_METERS(goalkeeperX), PIXEL_TO_METERS(goalkeeperY));
 			goalkeeperBody->body->SetTransform(newPos, 0.0f);
 		}
-		
-		// Draw goalkeeper centered on its position
-		DrawTextureEx(goalkeeper, 
-			Vector2{ goalkeeperX - scaledWidth / 2.0f, (float)goalkeeperY }, 
-			0.0f, scale, WHITE);
 	}
+}
+
+void ModuleGame::DrawMenu()
+{
+	DrawTexture(menuTexture, 0, 0, WHITE);
+	DrawText("Presiona ESPACIO para jugar", 200, 400, 30, WHITE);
+
+	float progress = App->assets.GetProgress();
+	if (progress < 1.0f)
+		DrawText(TextFormat("Cargando %d%%", (int)(progress * 100.0f)), 10, SCREEN_HEIGHT - 30, 20, WHITE);
+}
+
+void ModuleGame::Draw()
+{
+	// 1. Dibujar el fondo del juego
+	App->renderer->Draw(fondo, 0, 0);
 	
+	// Draw the ball
+	if (circleBody != nullptr)
+	{
+		int x, y;
+		circleBody->GetRenderPosition(x, y);
+		Vector2 position{ (float)x, (float)y };
+		float desired_radius = 9.0f;
 
-	//-------------------------------CONTROL DE LAS PALAS-------------------------//
-	// Control pala izquierda
-	if (IsKeyDown(KEY_LEFT)) {
-		pala_l_joint->SetMotorSpeed(-20.0f);
-	}
-	else {
-		pala_l_joint->SetMotorSpeed(10.0f);
-	}
+		// Calculate scale so texture width matches physical diameter
+		float scale = (desired_radius * 2.0f) / (float)circle.section.width;
 
-	// Control pala derecha
-	if (IsKeyDown(KEY_RIGHT)) {
-		pala_r_joint->SetMotorSpeed(20.0f);
+		Rectangle dest = { position.x, position.y, (float)circle.section.width * scale, (float)circle.section.height * scale };
+		Vector2 origin = { (float)circle.section.width * scale / 2.0f, (float)circle.section.height * scale / 2.0f };
+		float rotation = circleBody->GetRenderRotation() * RAD2DEG;
+
+		App->renderer->DrawSprite(circle.texture, circle.section, dest, origin, rotation, LAYER_BALLS);
 	}
-	else {
-		pala_r_joint->SetMotorSpeed(-10.0f);
+	
+	// Draw goalkeeper centered on its position
+	if (goalkeeper.texture.id != 0 && goalkeeperBody != nullptr) // Check if texture is loaded
+	{
+		float scaledWidth = goalkeeper.section.width * GOALKEEPER_SCALE;
+		float scaledHeight = goalkeeper.section.height * GOALKEEPER_SCALE;
+		float spriteY = goalkeeperY - 10.0f; // Near the top goal area
+
+		int x, y;
+		goalkeeperBody->GetRenderPosition(x, y);
+
+		App->renderer->DrawSprite(goalkeeper.texture, goalkeeper.section,
+			Rectangle{ (float)x - scaledWidth / 2.0f, spriteY, scaledWidth, scaledHeight },
+			Vector2{ 0.0f, 0.0f }, 0.0f, LAYER_TABLE);
 	}
-	//------------------------------FIN DE LOS CONTROLES PALAS------------------//
 
 	//------------------------------TEXTURA DE LAS PALAS------------------------//
 	int xL, yL;
-	pala_l->GetPhysicPosition(xL, yL);
+	pala_l->GetRenderPosition(xL, yL);
 
-	float w = pala_left.width * PALA_SCALE;
-	float h = pala_left.height * PALA_SCALE;
+	float w = pala_left.section.width * PALA_SCALE;
+	float h = pala_left.section.height * PALA_SCALE;
 
 	// El cuerpo f�sico rota alrededor de su centro, no del borde
 	Vector2 origin = { w / 2.0f, h / 2.0f };
 
-	DrawTexturePro(
-		pala_left,
-		Rectangle{ 0, 0, (float)pala_left.width, (float)pala_left.height },
+	App->renderer->DrawSprite(
+		pala_left.texture,
+		pala_left.section,
 		Rectangle{ (float)xL, (float)yL, w, h },
 		origin,
-		pala_l->GetRotation() * RAD2DEG,
-		WHITE);
+		pala_l->GetRenderRotation() * RAD2DEG,
+		LAYER_TABLE);
 
 	int xR, yR;
-	pala_r->GetPhysicPosition(xR, yR);
-	DrawTexturePro(pala_right,
-		Rectangle{ 0, 0, (float)pala_right.width, (float)pala_right.height },
-		Rectangle{ (float)xR, (float)yR, (float)pala_right.width * PALA_SCALE, (float)pala_right.height * PALA_SCALE },
+	pala_r->GetRenderPosition(xR, yR);
+	App->renderer->DrawSprite(pala_right.texture, pala_right.section,
+		Rectangle{ (float)xR, (float)yR, (float)pala_right.section.width * PALA_SCALE, (float)pala_right.section.height * PALA_SCALE },
 		//Vector2{0.0f, (float)pala_right.width / 2.0f, (float)pala_right.height / 2.0f },
-		Vector2{ (float)pala_left.width * PALA_SCALE / 2.0f, (float)pala_left.height * PALA_SCALE / 2.0f },
-		pala_r->GetRotation() * RAD2DEG,
-		WHITE);
-	ray_on = false;
+		Vector2{ (float)pala_left.section.width * PALA_SCALE / 2.0f, (float)pala_left.section.height * PALA_SCALE / 2.0f },
+		pala_r->GetRenderRotation() * RAD2DEG,
+		LAYER_TABLE);
 	//----------------------------------FIN TEXTURA PALAS------------------------//
+}
 
+void ModuleGame::DrawEntities()
+{
+	// Balls: el ancho de la textura coincide con el diámetro físico
+	float scale = (9.0f * 2.0f) / (float)circle.section.width;
+	Vector2 ball_origin = { (float)circle.section.width * scale / 2.0f, (float)circle.section.height * scale / 2.0f };
 
-	//----------------------------------Puntuación y Vidas-------------------------------//
-	DrawText(TextFormat("Score: %i", score), 682, 99, 23, WHITE);
-	DrawText(TextFormat("Lives: %i", lives), 682, 130, 23, WHITE);
-	
-	// Decrementar frames de ignorar colisiones
-	if (ignoreCollisionsFrames > 0)
-		ignoreCollisionsFrames--;
-	
-	// Verificar Game Over
-	if (lives <= 0)
-	{
-		gameStarted = false;
-		return UPDATE_CONTINUE;
-	}
-	//--------------------------------------------------------------------------//
-
-	if(IsKeyPressed(KEY_SPACE))
+	for (uint i = 0; i < balls.Count(); ++i)
 	{
-		ray_on = !ray_on;
-		ray.x = GetMouseX();
-		ray.y = GetMouseY();
-	}
+		const PhysBody* body = balls[i].body;
+		int x, y;
+		body->GetRenderPosition(x, y);
 
-	if(IsKeyPressed(KEY_ONE))
-	{
-		entities.emplace_back(new Circle(App->physics, GetMouseX(), GetMouseY(), this, circle));
-		
+		Rectangle dest = { (float)x, (float)y, (float)circle.section.width * scale, (float)circle.section.height * scale };
+		App->renderer->DrawSprite(circle.texture, circle.section, dest, ball_origin, body->GetRenderRotation() * RAD2DEG, LAYER_BALLS);
 	}
 
+	Vector2 crate_origin = { (float)box.section.width / 2.0f, (float)box.section.height / 2.0f };
 
-	if(IsKeyPressed(KEY_TWO))
+	for (uint i = 0; i < crates.Count(); ++i)
 	{
-		entities.emplace_back(new Box(App->physics, GetMouseX(), GetMouseY(), this, box));
-	}
+		const PhysBody* body = crates[i].body;
+		int x, y;
+		body->GetRenderPosition(x, y);
 
+		Rectangle dest = { (float)x, (float)y, (float)box.section.width, (float)box.section.height };
+		App->renderer->DrawSprite(box.texture, box.section, dest, crate_origin, body->GetRenderRotation() * RAD2DEG, LAYER_CRATES);
+	}
+}
 
-	// Prepare for raycast ------------------------------------------------------
-	
-	vec2i mouse;
-	mouse.x = GetMouseX();
-	mouse.y = GetMouseY();
-	int ray_hit = ray.DistanceTo(mouse);
+// Drawn over the sprites: raycast against the world and the score
+void ModuleGame::DrawOverlay()
+{
+	// ray -----------------
+	if(ray_on == true)
+	{
+		vec2i mouse;
+		mouse.x = App->input->GetMouseX();
+		mouse.y = App->input->GetMouseY();
+		int ray_hit = ray.DistanceTo(mouse);
 
-	vec2f normal(0.0f, 0.0f);
+		vec2f normal(0.0f, 0.0f);
 
-	for (PhysicEntity* entity : entities)
-	{
-		entity->Update();
-		if (ray_on)
+		// Nearest hit against everything but the sensors
+		RayHit hit;
+		if (App->physics->RayCast(ray.x, ray.y, mouse.x, mouse.y, hit, PHYS_CATEGORY_ALL & ~PHYS_CATEGORY_SENSOR))
 		{
-			int hit = entity->RayHit(ray, mouse, normal);
-			if (hit >= 0)
-			{
-				ray_hit = hit;
-			}
+			ray_hit = hit.distance;
+			normal.x = hit.normal_x;
+			normal.y = hit.normal_y;
 		}
-	}
 
-	// ray -----------------
-	if(ray_on == true)
-	{
 		vec2f destination((float)(mouse.x-ray.x), (float)(mouse.y-ray.y));
 		destination.Normalize();
 		destination *= (float)ray_hit;
@@ -563,14 +659,68 @@ update_status ModuleGame::Update()
 		}
 	}
 
-	if (resetPending)
+	//----------------------------------Puntuación y Vidas-------------------------------//
+	DrawText(TextFormat("Score: %i", score), 682, 99, 23, WHITE);
+	DrawText(TextFormat("Lives: %i", lives), 682, 130, 23, WHITE);
+	//--------------------------------------------------------------------------//
+}
+
+EntityHandle ModuleGame::SpawnBall(int x, int y)
+{
+	PhysBody* body = App->physics->CreateCircle(x, y, 9); //radio de colision de la pelota
+	body->listener = this;
+
+	Ball ball;
+	ball.body = body;
+	return balls.Spawn(ball);
+}
+
+EntityHandle ModuleGame::SpawnCrate(int x, int y)
+{
+	PhysBody* body = App->physics->CreateRectangle(x, y, 100, 50);
+	body->listener = this;
+
+	Crate crate;
+	crate.body = body;
+	return crates.Spawn(crate);
+}
+
+void ModuleGame::DespawnEntities()
+{
+	for (uint i = 0; i < balls.Count(); ++i)
+		App->physics->DestroyBody(balls[i].body);
+
+	for (uint i = 0; i < crates.Count(); ++i)
+		App->physics->DestroyBody(crates[i].body);
+
+	balls.Clear();
+	crates.Clear();
+}
+
+// Free the bodies that fell behind the flippers so their slots get recycled
+void ModuleGame::DespawnDrained()
+{
+	for (uint i = balls.Count(); i-- > 0;)
 	{
-		ResetBall();
-		resetPending = false;
+		int x, y;
+		balls[i].body->GetPhysicPosition(x, y);
+		if (y > drain_y)
+		{
+			App->physics->DestroyBody(balls[i].body);
+			balls.DespawnAt(i);
+		}
 	}
 
-
-	return UPDATE_CONTINUE;
+	for (uint i = crates.Count(); i-- > 0;)
+	{
+		int x, y;
+		crates[i].body->GetPhysicPosition(x, y);
+		if (y > drain_y)
+		{
+			App->physics->DestroyBody(crates[i].body);
+			crates.DespawnAt(i);
+		}
+	}
 }
 
 void ModuleGame::ResetBall()
@@ -606,29 +756,38 @@ void ModuleGame::ResetBall()
 		// Empuje inicial hacia abajo con ligera variación lateral
 		float horizontalPush = (spawnSide == 0) ? 0.5f : -0.5f; // Pequeño impulso hacia el centro
 		circleBody->body->SetLinearVelocity(b2Vec2(horizontalPush, currentBallVelocity));
+		circleBody->ResetInterpolation();
 		
-		// Ignorar colisiones por 30 frames (medio segundo a 60fps)
-		ignoreCollisionsFrames = 30;
+		// Ignorar colisiones durante medio segundo
+		ignoreCollisionsTime = 0.5f;
 	}
 }
 
 
 
-void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB)
+void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB, float impulse)
 {
 	// No procesar colisiones si el juego no ha empezado
 	if (!gameStarted)
 		return;
 	
-	// Ignorar colisiones durante los primeros frames después de resetear
-	if (ignoreCollisionsFrames > 0)
+	// Ignorar colisiones durante el primer medio segundo después de resetear
+	if (ignoreCollisionsTime > 0.0f)
 		return;
     
-	// Evitar procesar múltiples veces en el mismo frame si ya hay un reset pendiente
-	if (resetPending)
+	// Golpes de la pelota, el volumen depende del impulso del choque
+	if (circleBody != nullptr && bodyA == circleBody)
+	{
+		if (bodyB == pala_l || bodyB == pala_r)
+			App->audio->PlayFlipperHit(impulse / FULL_HIT_IMPULSE);
+		else if (bodyB == goalkeeperBody)
+			App->audio->PlayBumperHit(impulse / FULL_HIT_IMPULSE);
 		return;
-	
-	// Solo nos interesan colisiones de sensores con la pelota
+	}
+
+	// Solo nos interesan colisiones de sensores con la pelota. Los eventos llegan
+	// después del step, así que la pelota se puede recolocar aquí mismo y
+	// ResetBall ignora el resto de contactos del mismo step
 	const bool ballHit = (circleBody != nullptr && bodyB == circleBody);
 
 	// Gol en portería rival (arriba) - suma punto (solo si bodyA es el sensor y bodyB es la pelota)
@@ -636,18 +795,18 @@ void ModuleGame::OnCollision(PhysBody* bodyA, PhysBody* bodyB)
 	{
 		score++;
 		App->audio->PlayFx(bonus_fx);
-		resetPending = true;
+		ResetBall();
 	}
 	// Pelota entra en portería propia (entre palancas) - resta vida (solo si bodyA es el sensor y bodyB es la pelota)
 	else if (bodyA == ownGoalSensor && ballHit)
 	{
 		lives--;
-		resetPending = true;
+		ResetBall();
 	}
 	// Pelota cae abajo (detrás de palancas) - resta punto (solo si bodyA es el sensor y bodyB es la pelota)
 	else if (bodyA == sensor && ballHit)
 	{
 		score--;
-		resetPending = true;
+		ResetBall();
 	}
 }
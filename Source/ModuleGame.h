@@ -2,10 +2,15 @@
 
 #include "Globals.h"
 #include "Module.h"
+#include "EntityPool.h"
+#include "TextureAtlas.h"
+#include "TableFile.h"
+#include "FileWatcher.h"
 
 #include "p2Point.h"
 
 #include "raylib.h"
+#include <string>
 #include <vector>
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -17,8 +22,17 @@
 #pragma warning(pop)
 #endif
 class PhysBody;
-class PhysicEntity;
 
+// Balls (KEY_ONE) and crates (KEY_TWO) spawned by the player
+struct Ball
+{
+	PhysBody* body = nullptr;
+};
+
+struct Crate
+{
+	PhysBody* body = nullptr;
+};
 
 class ModuleGame : public Module
 {
@@ -29,12 +43,40 @@ public:
 	bool Start();
 	update_status Update();
 	bool CleanUp();
-	void OnCollision(PhysBody* bodyA, PhysBody* bodyB);
+	void OnCollision(PhysBody* bodyA, PhysBody* bodyB, float impulse);
+	void OnPhysicsStep(float dt);
+	void OnSaveSnapshot(uchar* data, uint size);
+	void OnRestoreSnapshot(const uchar* data, uint size);
 	void ResetBall();
 
-	std::vector<PhysicEntity*> entities{};
+	EntityHandle SpawnBall(int x, int y);
+	EntityHandle SpawnCrate(int x, int y);
+	void DespawnEntities();
+
+	// Table loaded by Start, Assets/table.txt unless set before
+	void SetTablePath(const char* path);
+	// Development mode: the table and its textures are reloaded when their files change
+	void SetHotReload(bool enable);
+
+private:
+	void LoadRegions();
+	bool LoadTable(bool force = false);
+	uint BuildTable();
+	void BuildFlipper(const TableFlipper& flipper, PhysBody*& pivote, PhysBody*& pala, b2RevoluteJoint*& joint);
+	void HotReload();
+	void DespawnDrained();
+	void DrawMenu();
+	void Draw();
+	void DrawEntities();
+	void DrawOverlay();
+
+public:
+
+	EntityPool<Ball> balls;
+	EntityPool<Crate> crates;
     
 	PhysBody* sensor = nullptr;
+	int drain_y = 0;	// spawned entities below the drain sensor fell behind the flippers
 	PhysBody* pala_r = nullptr;
 	PhysBody* pala_l = nullptr;
 	PhysBody* goalSensor = nullptr;
@@ -42,25 +84,43 @@ public:
 	PhysBody* goalkeeperBody = nullptr;
 	PhysBody* circleBody = nullptr;
 	bool sensed = false;
-	bool resetPending = false;
 	bool gameStarted = false;
-	int ignoreCollisionsFrames = 0;
+	float ignoreCollisionsTime = 0.0f;
     
+	TableFile table;
+	std::string table_path;
+
+	// What the table bodies were built from, a reload only rebuilds what differs
+	TableHeader built_header{};
+	std::vector<TableSensor> built_sensors;
+	std::vector<PhysBody*> sensor_bodies;
+	std::vector<std::vector<b2Vec2>> built_chains;
+	std::vector<PhysBody*> chain_bodies;
+	PhysBody* pivote_l = nullptr;
+	PhysBody* pivote_r = nullptr;
+
+	bool hot_reload = false;
+	FileWatcher watcher;
+	std::vector<std::string> changed_files;
+
 	// Goalkeeper animation variables
 	float goalkeeperX = 0.0f;
+	float goalkeeperY = 0.0f;
+	float goalLeft = 0.0f;
+	float goalRight = 0.0f;
 	float goalkeeperSpeed = 0.0f;
 	bool goalkeeperMovingRight = false;
 	
-	// Speed scaling: 5% increase per point
-	float baseGoalkeeperSpeed = 1.5f;
+	// Speed scaling: 5% increase per point, goalkeeper speed in pixels per second
+	float baseGoalkeeperSpeed = 90.0f;
 	float baseballVelocity = 3.0f;
 
-	Texture2D circle{};
-	Texture2D box{};
+	AtlasRegion circle;
+	AtlasRegion box;
 	Texture2D fondo{};
-	Texture2D pala_right{};
-	Texture2D pala_left{};
-	Texture2D goalkeeper{};
+	AtlasRegion pala_right;
+	AtlasRegion pala_left;
+	AtlasRegion goalkeeper;
 	Texture2D menuTexture{};
 
 	b2RevoluteJoint* pala_l_joint = nullptr; 
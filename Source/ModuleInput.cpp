@@ -0,0 +1,278 @@
+#include "Globals.h"
+#include "Application.h"
+#include "ModuleInput.h"
+#include "ModulePhysics.h"
+
+#include <time.h>
+
+ModuleInput::ModuleInput(Application* app, bool start_enabled) : Module(app, start_enabled)
+{
+	record_path = NULL;
+	replay_path = NULL;
+
+	record_file = NULL;
+	replay_cursor = 0;
+
+	random_seed = 0;
+	physics_rate = 0.0f;
+}
+
+// Destructor
+ModuleInput::~ModuleInput()
+{
+}
+
+bool ModuleInput::Init()
+{
+	LOG("Init input");
+	bool ret = true;
+
+	if (replay_path != NULL)
+	{
+		ret = LoadReplay();
+	}
+	else
+	{
+		random_seed = (uint32)time(NULL);
+	}
+
+	// ModuleGame::ResetBall picks the spawn side with GetRandomValue
+	SetRandomSeed(random_seed);
+
+	return ret;
+}
+
+bool ModuleInput::Start()
+{
+	if (IsReplaying())
+	{
+		// The log only reproduces the session at the rate it was recorded with
+		App->physics->SetStepRate(physics_rate);
+	}
+	else if (record_path != NULL)
+	{
+		if (fopen_s(&record_file, record_path, "wb") != 0 || record_file == NULL)
+		{
+			LOG("Cannot open input log for writing: %s", record_path);
+			return false;
+		}
+
+		uint32 magic = INPUT_LOG_MAGIC;
+		uint32 version = INPUT_LOG_VERSION;
+		physics_rate = 1.0f / App->physics->GetStepTime();
+
+		fwrite(&magic, sizeof(magic), 1, record_file);
+		fwrite(&version, sizeof(version), 1, record_file);
+		fwrite(&random_seed, sizeof(random_seed), 1, record_file);
+		fwrite(&physics_rate, sizeof(physics_rate), 1, record_file);
+	}
+
+	return true;
+}
+
+update_status ModuleInput::PreUpdate()
+{
+	if (IsReplaying())
+	{
+		if (replay_cursor >= replay_frames.size())
+		{
+			LOG("Input replay finished after %u frames", replay_cursor);
+
+			if (App->IsHeadless())
+				return UPDATE_STOP;
+
+			// With a window, the player takes over once the log runs out
+			replay_frames.clear();
+			current = SampleFrame();
+		}
+		else
+		{
+			current = replay_frames[replay_cursor++];
+		}
+	}
+	else
+	{
+		current = SampleFrame();
+	}
+
+	if (record_file != NULL)
+		WriteFrame(current);
+
+	return UPDATE_CONTINUE;
+}
+
+// Called before quitting
+bool ModuleInput::CleanUp()
+{
+	LOG("Closing input log");
+
+	if (record_file != NULL)
+	{
+		fclose(record_file);
+		record_file = NULL;
+	}
+
+	replay_frames.clear();
+
+	return true;
+}
+
+void ModuleInput::SetRecordPath(const char* path)
+{
+	record_path = path;
+}
+
+void ModuleInput::SetReplayPath(const char* path)
+{
+	replay_path = path;
+}
+
+bool ModuleInput::IsRecording() const
+{
+	return record_file != NULL;
+}
+
+bool ModuleInput::IsReplaying() const
+{
+	return replay_frames.empty() == false;
+}
+
+bool ModuleInput::IsKeyDown(int key) const
+{
+	switch (key)
+	{
+	case KEY_LEFT: return (current.flags & INPUT_LEFT_DOWN) != 0;
+	case KEY_RIGHT: return (current.flags & INPUT_RIGHT_DOWN) != 0;
+	case KEY_F5: return (current.flags & INPUT_F5_DOWN) != 0;
+	default: return false;
+	}
+}
+
+bool ModuleInput::IsKeyPressed(int key) const
+{
+	switch (key)
+	{
+	case KEY_SPACE: return (current.flags & INPUT_SPACE_PRESSED) != 0;
+	case KEY_ONE: return (current.flags & INPUT_ONE_PRESSED) != 0;
+	case KEY_TWO: return (current.flags & INPUT_TWO_PRESSED) != 0;
+	case KEY_F1: return (current.flags & INPUT_F1_PRESSED) != 0;
+	case KEY_F2: return (current.flags & INPUT_F2_PRESSED) != 0;
+	case KEY_F3: return (current.flags & INPUT_F3_PRESSED) != 0;
+	case KEY_F4: return (current.flags & INPUT_F4_PRESSED) != 0;
+	default: return false;
+	}
+}
+
+bool ModuleInput::IsMouseButtonDown(int button) const
+{
+	return button == MOUSE_BUTTON_LEFT && (current.flags & INPUT_MOUSE_LEFT_DOWN) != 0;
+}
+
+bool ModuleInput::IsMouseButtonReleased(int button) const
+{
+	return button == MOUSE_BUTTON_LEFT && (current.flags & INPUT_MOUSE_LEFT_RELEASED) != 0;
+}
+
+int ModuleInput::GetMouseX() const
+{
+	return current.mouse_x;
+}
+
+int ModuleInput::GetMouseY() const
+{
+	return current.mouse_y;
+}
+
+Vector2 ModuleInput::GetMousePosition() const
+{
+	return Vector2{ (float)current.mouse_x, (float)current.mouse_y };
+}
+
+float ModuleInput::GetDeltaTime() const
+{
+	return current.dt;
+}
+
+InputFrame ModuleInput::SampleFrame() const
+{
+	InputFrame frame;
+
+	// Without a window time advances one nominal frame per update and SPACE
+	// is held pressed so the game leaves the menu and restarts after game over
+	if (App->IsHeadless())
+	{
+		frame.dt = 1.0f / FRAME_RATE;
+		frame.flags = INPUT_SPACE_PRESSED;
+		return frame;
+	}
+
+	frame.dt = GetFrameTime();
+	if (frame.dt > MAX_FRAME_TIME) frame.dt = MAX_FRAME_TIME;
+
+	if (::IsKeyDown(KEY_LEFT)) frame.flags |= INPUT_LEFT_DOWN;
+	if (::IsKeyDown(KEY_RIGHT)) frame.flags |= INPUT_RIGHT_DOWN;
+	if (::IsKeyPressed(KEY_SPACE)) frame.flags |= INPUT_SPACE_PRESSED;
+	if (::IsKeyPressed(KEY_ONE)) frame.flags |= INPUT_ONE_PRESSED;
+	if (::IsKeyPressed(KEY_TWO)) frame.flags |= INPUT_TWO_PRESSED;
+	if (::IsKeyPressed(KEY_F1)) frame.flags |= INPUT_F1_PRESSED;
+	if (::IsKeyPressed(KEY_F2)) frame.flags |= INPUT_F2_PRESSED;
+	if (::IsKeyPressed(KEY_F3)) frame.flags |= INPUT_F3_PRESSED;
+	if (::IsKeyPressed(KEY_F4)) frame.flags |= INPUT_F4_PRESSED;
+	if (::IsKeyDown(KEY_F5)) frame.flags |= INPUT_F5_DOWN;
+	if (::IsMouseButtonDown(MOUSE_BUTTON_LEFT)) frame.flags |= INPUT_MOUSE_LEFT_DOWN;
+	if (::IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) frame.flags |= INPUT_MOUSE_LEFT_RELEASED;
+
+	frame.mouse_x = (short)::GetMouseX();
+	frame.mouse_y = (short)::GetMouseY();
+
+	return frame;
+}
+
+// Log layout: magic, version, random seed, physics rate, then 10 bytes per frame
+bool ModuleInput::LoadReplay()
+{
+	FILE* file = NULL;
+
+	if (fopen_s(&file, replay_path, "rb") != 0 || file == NULL)
+	{
+		LOG("Cannot open input log: %s", replay_path);
+		return false;
+	}
+
+	uint32 magic = 0, version = 0;
+	fread(&magic, sizeof(magic), 1, file);
+	fread(&version, sizeof(version), 1, file);
+
+	if (magic != INPUT_LOG_MAGIC || version != INPUT_LOG_VERSION)
+	{
+		LOG("Invalid input log: %s", replay_path);
+		fclose(file);
+		return false;
+	}
+
+	fread(&random_seed, sizeof(random_seed), 1, file);
+	fread(&physics_rate, sizeof(physics_rate), 1, file);
+
+	InputFrame frame;
+	while (fread(&frame.dt, sizeof(frame.dt), 1, file) == 1 &&
+		fread(&frame.flags, sizeof(frame.flags), 1, file) == 1 &&
+		fread(&frame.mouse_x, sizeof(frame.mouse_x), 1, file) == 1 &&
+		fread(&frame.mouse_y, sizeof(frame.mouse_y), 1, file) == 1)
+	{
+		replay_frames.push_back(frame);
+	}
+
+	fclose(file);
+
+	LOG("Loaded input log %s: %u frames", replay_path, (uint)replay_frames.size());
+
+	return replay_frames.empty() == false;
+}
+
+void ModuleInput::WriteFrame(const InputFrame& frame)
+{
+	fwrite(&frame.dt, sizeof(frame.dt), 1, record_file);
+	fwrite(&frame.flags, sizeof(frame.flags), 1, record_file);
+	fwrite(&frame.mouse_x, sizeof(frame.mouse_x), 1, record_file);
+	fwrite(&frame.mouse_y, sizeof(frame.mouse_y), 1, record_file);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Module.h"
+#include "Globals.h"
+
+#include <vector>
+
+#define INPUT_LOG_MAGIC		0x52494250 // "PBIR"
+#define INPUT_LOG_VERSION	4
+
+// Every input the game reads in one frame, one bit per tracked key/button
+enum InputFlag
+{
+	INPUT_LEFT_DOWN = 1 << 0,
+	INPUT_RIGHT_DOWN = 1 << 1,
+	INPUT_SPACE_PRESSED = 1 << 2,
+	INPUT_ONE_PRESSED = 1 << 3,
+	INPUT_TWO_PRESSED = 1 << 4,
+	INPUT_F1_PRESSED = 1 << 5,
+	INPUT_MOUSE_LEFT_DOWN = 1 << 6,
+	INPUT_MOUSE_LEFT_RELEASED = 1 << 7,
+	INPUT_F5_DOWN = 1 << 8,
+	INPUT_F3_PRESSED = 1 << 9,
+	INPUT_F4_PRESSED = 1 << 10,
+	INPUT_F2_PRESSED = 1 << 11
+};
+
+struct InputFrame
+{
+	float dt = 0.0f;
+	unsigned short flags = 0;
+	short mouse_x = 0;
+	short mouse_y = 0;
+};
+
+// Samples the input once per frame so it can be written to a log and
+// played back later, headless or with a window, with the same results
+class ModuleInput : public Module
+{
+public:
+
+	ModuleInput(Application* app, bool start_enabled = true);
+	~ModuleInput();
+
+	bool Init();
+	bool Start();
+	update_status PreUpdate();
+	bool CleanUp();
+
+	// Must be called before Init()
+	void SetRecordPath(const char* path);
+	void SetReplayPath(const char* path);
+
+	bool IsRecording() const;
+	bool IsReplaying() const;
+
+	// Only the keys and buttons listed in InputFlag are tracked
+	bool IsKeyDown(int key) const;
+	bool IsKeyPressed(int key) const;
+	bool IsMouseButtonDown(int button) const;
+	bool IsMouseButtonReleased(int button) const;
+
+	int GetMouseX() const;
+	int GetMouseY() const;
+	Vector2 GetMousePosition() const;
+
+	// Seconds the simulation advances this frame
+	float GetDeltaTime() const;
+
+private:
+
+	InputFrame SampleFrame() const;
+	bool LoadReplay();
+	void WriteFrame(const InputFrame& frame);
+
+private:
+
+	InputFrame current;
+
+	const char* record_path;
+	const char* replay_path;
+
+	FILE* record_file;
+	std::vector<InputFrame> replay_frames;
+	uint replay_cursor;
+
+	uint32 random_seed;
+	float physics_rate;
+};
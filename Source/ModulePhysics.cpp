@@ -1,17 +1,132 @@
 #include "Globals.h"
 #include "Application.h"
 #include "ModuleRender.h"
+#include "ModuleInput.h"
 #include "ModulePhysics.h"
 
 #include "p2Point.h"
 
 #include <math.h>
+#include <algorithm>
+#include <unordered_map>
 
-ModulePhysics::ModulePhysics(Application* app, bool start_enabled) : Module(app, start_enabled)
+// Exact TestPoint on the fixtures the broadphase reports around a point
+class PointQueryCallback : public b2QueryCallback
+{
+public:
+
+	PointQueryCallback(const b2Vec2& _point, bool _include_sensors, std::vector<PhysBody*>* _result)
+		: point(_point)
+		, include_sensors(_include_sensors)
+		, result(_result)
+		, topmost(nullptr)
+	{}
+
+	bool ReportFixture(b2Fixture* fixture) override
+	{
+		if (fixture->IsSensor() && include_sensors == false)
+			return true;
+
+		// The mouse joint ground body is the only one without a PhysBody
+		PhysBody* pbody = reinterpret_cast<PhysBody*>(fixture->GetBody()->GetUserData().pointer);
+		if (pbody == nullptr || fixture->TestPoint(point) == false)
+			return true;
+
+		if (result != nullptr && std::find(result->begin(), result->end(), pbody) == result->end())
+			result->push_back(pbody);
+
+		if (topmost == nullptr || IsAbove(pbody, topmost))
+			topmost = pbody;
+
+		return true;
+	}
+
+	static bool IsAbove(const PhysBody* a, const PhysBody* b)
+	{
+		// b2BodyType goes static, kinematic, dynamic
+		if (a->body->GetType() != b->body->GetType())
+			return a->body->GetType() > b->body->GetType();
+
+		return a->serial > b->serial;
+	}
+
+public:
+
+	b2Vec2 point;
+	bool include_sensors;
+	std::vector<PhysBody*>* result;
+	PhysBody* topmost;
+};
+
+// Reports the fixtures b2World::RayCast crosses, keeping the nearest one or all of them
+class RayCastCallback : public b2RayCastCallback
+{
+public:
+
+	RayCastCallback(uint16 _mask, std::vector<RayHit>* _all)
+		: mask(_mask)
+		, all(_all)
+		, length(0.0f)
+	{}
+
+	float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override
+	{
+		// -1 skips the fixture and keeps the ray going
+		if ((fixture->GetFilterData().categoryBits & mask) == 0)
+			return -1.0f;
+
+		PhysBody* pbody = reinterpret_cast<PhysBody*>(fixture->GetBody()->GetUserData().pointer);
+		if (pbody == nullptr)
+			return -1.0f;
+
+		RayHit hit;
+		hit.body = pbody;
+		hit.x = METERS_TO_PIXELS(point.x);
+		hit.y = METERS_TO_PIXELS(point.y);
+		hit.normal_x = normal.x;
+		hit.normal_y = normal.y;
+		hit.fraction = fraction;
+		hit.distance = (int)(fraction * length);
+
+		if (all != nullptr)
+		{
+			all->push_back(hit);
+			return 1.0f;
+		}
+
+		// Clipping the ray to this hit leaves only nearer fixtures to report
+		nearest = hit;
+		return fraction;
+	}
+
+public:
+
+	uint16 mask;
+	std::vector<RayHit>* all;
+	float length;
+	RayHit nearest;
+};
+
+ModulePhysics::ModulePhysics(Application* app, bool start_enabled) : Module(app, start_enabled), contact_stat("Contacts")
 {
 	world = NULL;
 	mouse_joint = NULL;
 	debug = false;
+	next_serial = 0;
+	table_build = false;
+	table_statics = 0;
+
+	step_time = 1.0f / PHYSICS_RATE;
+	accumulator = 0.0f;
+	step_count = 0;
+	steps_taken = 0;
+	frame_profile = b2Profile();
+	frame_steps = 0;
+
+	snapshot_listener = nullptr;
+
+	parallel = false;
+	worker_threads = 0;
 }
 
 // Destructor
@@ -26,6 +141,20 @@ bool ModulePhysics::Start()
 	world = new b2World(b2Vec2(GRAVITY_X, -GRAVITY_Y));
 	world->SetContactListener(this);
 
+	if (parallel)
+	{
+		workers.Start(worker_threads);
+		world->SetTaskExecutor(&workers);
+	}
+
+	snapshots.Init(SNAPSHOT_RING_SIZE);
+	LOG("Snapshot ring: %u steps", snapshots.GetCapacity());
+	world->SetDebugDraw(&debug_draw);
+	App->profiler.AddStat(&contact_stat);
+	contact_events.reserve(CONTACT_EVENTS_RESERVE);
+	begin_events.reserve(CONTACT_EVENTS_RESERVE);
+	step_impulses.reserve(CONTACT_IMPULSES_RESERVE);
+
 	// needed to create joints like mouse joint
 	b2BodyDef bd;
 	ground = world->CreateBody(&bd);
@@ -33,13 +162,460 @@ bool ModulePhysics::Start()
 	return true;
 }
 
+// Step the world at a fixed rate, independent of how fast frames are rendered
 update_status ModulePhysics::PreUpdate()
 {
-	world->Step(1.0f / 60.0f, 6, 2);
+	accumulator += App->GetDeltaTime();
+	frame_profile = b2Profile();
+	frame_steps = 0;
+
+	// Holding F5 every step due goes back one instead
+	bool rewind = App->input->IsKeyDown(KEY_F5);
+
+	while (accumulator >= step_time)
+	{
+		if (rewind)
+		{
+			Rewind(1);
+			accumulator -= step_time;
+			continue;
+		}
+
+		for (PhysBody* pbody : bodies)
+		{
+			pbody->prev_position = pbody->body->GetPosition();
+			pbody->prev_angle = pbody->body->GetAngle();
+		}
+
+		for (Module* listener : step_listeners)
+		{
+			listener->OnPhysicsStep(step_time);
+		}
+
+		world->Step(step_time, 6, 2);
+		accumulator -= step_time;
+
+		// The world is unlocked again, listeners may create, destroy or move bodies
+		MatchImpulses();
+		DispatchContacts();
+
+		step_count++;
+		steps_taken++;
+		SaveSnapshot(snapshots.Push());
+
+		const b2Profile& profile = world->GetProfile();
+		frame_profile.step += profile.step;
+		frame_profile.collide += profile.collide;
+		frame_profile.solve += profile.solve;
+		frame_profile.solveInit += profile.solveInit;
+		frame_profile.solveVelocity += profile.solveVelocity;
+		frame_profile.solvePosition += profile.solvePosition;
+		frame_profile.broadphase += profile.broadphase;
+		frame_profile.solveTOI += profile.solveTOI;
+		frame_steps++;
+	}
+
+	InterpolateBodies(accumulator / step_time);
 
 	return UPDATE_CONTINUE;
 }
 
+void ModulePhysics::InterpolateBodies(float alpha)
+{
+	for (PhysBody* pbody : bodies)
+	{
+		const b2Body* b = pbody->body;
+
+		if (b->GetType() == b2_staticBody)
+		{
+			pbody->render_position = b->GetPosition();
+			pbody->render_angle = b->GetAngle();
+			continue;
+		}
+
+		pbody->render_position = (1.0f - alpha) * pbody->prev_position + alpha * b->GetPosition();
+		pbody->render_angle = (1.0f - alpha) * pbody->prev_angle + alpha * b->GetAngle();
+	}
+}
+
+PhysBody* ModulePhysics::TrackBody(PhysBody* pbody)
+{
+	pbody->ResetInterpolation();
+	pbody->index = (int)bodies.size();
+	pbody->serial = next_serial++;
+	bodies.push_back(pbody);
+
+	if (table_build && pbody->body->GetType() == b2_staticBody)
+		table_statics++;
+
+	return pbody;
+}
+
+void ModulePhysics::BeginTableBuild()
+{
+	table_build = true;
+	table_statics = 0;
+}
+
+// Proxies went into the tree one by one while the table was created, rebuild it
+// once now that all of them are there. Box2D keeps static and moving proxies in
+// the same tree, so the few moving bodies created meanwhile are rebuilt too
+void ModulePhysics::EndTableBuild()
+{
+	int height = world->GetTreeHeight();
+	float quality = world->GetTreeQuality();
+
+	world->RebuildTree();
+	debug_draw.InvalidateStatic();
+	table_build = false;
+
+	LOG("Table built: %d static bodies, %d proxies, tree height %d -> %d, quality %.2f -> %.2f",
+		table_statics, world->GetProxyCount(), height, world->GetTreeHeight(), quality, world->GetTreeQuality());
+}
+
+void ModulePhysics::DestroyBody(PhysBody* pbody)
+{
+	if (mouse_joint != nullptr && mouse_joint->GetBodyB() == pbody->body)
+	{
+		world->DestroyJoint(mouse_joint);
+		mouse_joint = nullptr;
+	}
+
+	if (pbody->body->GetType() == b2_staticBody)
+		debug_draw.InvalidateStatic();
+
+	world->DestroyBody(pbody->body);
+
+	// Pending events (also the EndContact just raised by DestroyBody) must not reach it
+	for (ContactEvent& event : contact_events)
+	{
+		if (event.body_a == pbody) event.body_a = nullptr;
+		if (event.body_b == pbody) event.body_b = nullptr;
+	}
+
+	// El último ocupa el hueco para no desplazar todo el vector
+	PhysBody* last = bodies.back();
+	bodies[pbody->index] = last;
+	last->index = pbody->index;
+	bodies.pop_back();
+
+	delete pbody;
+}
+
+PhysBody* ModulePhysics::QueryPoint(int x, int y, bool include_sensors) const
+{
+	b2Vec2 point(PIXEL_TO_METERS(x), PIXEL_TO_METERS(y));
+	PointQueryCallback query(point, include_sensors, nullptr);
+
+	b2AABB aabb;
+	aabb.lowerBound = point - b2Vec2(b2_linearSlop, b2_linearSlop);
+	aabb.upperBound = point + b2Vec2(b2_linearSlop, b2_linearSlop);
+	world->QueryAABB(&query, aabb);
+
+	return query.topmost;
+}
+
+uint ModulePhysics::QueryPointAll(int x, int y, std::vector<PhysBody*>& result, bool include_sensors) const
+{
+	b2Vec2 point(PIXEL_TO_METERS(x), PIXEL_TO_METERS(y));
+	PointQueryCallback query(point, include_sensors, &result);
+
+	result.clear();
+
+	b2AABB aabb;
+	aabb.lowerBound = point - b2Vec2(b2_linearSlop, b2_linearSlop);
+	aabb.upperBound = point + b2Vec2(b2_linearSlop, b2_linearSlop);
+	world->QueryAABB(&query, aabb);
+
+	return (uint)result.size();
+}
+
+bool ModulePhysics::RayCast(int x1, int y1, int x2, int y2, RayHit& hit, uint16 mask) const
+{
+	RaySegment ray = { x1, y1, x2, y2 };
+	return RayCastBatch(&ray, 1, &hit, mask) == 1;
+}
+
+uint ModulePhysics::RayCastAll(int x1, int y1, int x2, int y2, std::vector<RayHit>& hits, uint16 mask) const
+{
+	hits.clear();
+
+	b2Vec2 p1(PIXEL_TO_METERS(x1), PIXEL_TO_METERS(y1));
+	b2Vec2 p2(PIXEL_TO_METERS(x2), PIXEL_TO_METERS(y2));
+	if (p1 == p2)
+		return 0;
+
+	RayCastCallback callback(mask, &hits);
+	callback.length = sqrtf((float)((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)));
+	world->RayCast(&callback, p1, p2);
+
+	// b2World reports the fixtures in broadphase order
+	std::sort(hits.begin(), hits.end(), [](const RayHit& a, const RayHit& b) { return a.fraction < b.fraction; });
+
+	return (uint)hits.size();
+}
+
+uint ModulePhysics::RayCastBatch(const RaySegment* rays, uint count, RayHit* hits, uint16 mask) const
+{
+	RayCastCallback callback(mask, nullptr);
+	uint hit_count = 0;
+
+	for (uint i = 0; i < count; ++i)
+	{
+		const RaySegment& ray = rays[i];
+		b2Vec2 p1(PIXEL_TO_METERS(ray.x1), PIXEL_TO_METERS(ray.y1));
+		b2Vec2 p2(PIXEL_TO_METERS(ray.x2), PIXEL_TO_METERS(ray.y2));
+
+		callback.nearest = RayHit();
+
+		// b2World::RayCast asserts on zero length rays
+		if (p1 != p2)
+		{
+			callback.length = sqrtf((float)((ray.x2 - ray.x1) * (ray.x2 - ray.x1) + (ray.y2 - ray.y1) * (ray.y2 - ray.y1)));
+			world->RayCast(&callback, p1, p2);
+		}
+
+		hits[i] = callback.nearest;
+		if (hits[i].body != nullptr)
+			hit_count++;
+	}
+
+	return hit_count;
+}
+
+void ModulePhysics::SetWorkerThreads(uint threads)
+{
+	parallel = true;
+	worker_threads = threads;
+}
+
+void ModulePhysics::SetStepRate(float hz)
+{
+	if (hz <= 0.0f) return;
+
+	step_time = 1.0f / hz;
+	accumulator = 0.0f;
+}
+
+float ModulePhysics::GetStepTime() const
+{
+	return step_time;
+}
+
+void ModulePhysics::AddStepListener(Module* listener)
+{
+	step_listeners.push_back(listener);
+}
+
+void ModulePhysics::SaveSnapshot(WorldSnapshot& snapshot)
+{
+	snapshot.step = step_count;
+	snapshot.bodies.clear();
+	snapshot.joints.clear();
+	snapshot.contacts.clear();
+
+	for (const PhysBody* pbody : bodies)
+	{
+		const b2Body* b = pbody->body;
+
+		if (b->GetType() == b2_staticBody)
+			continue;
+
+		BodySnapshot state;
+		const b2Vec2& position = b->GetPosition();
+		const b2Vec2& velocity = b->GetLinearVelocity();
+
+		state.serial = pbody->serial;
+		state.x = position.x;
+		state.y = position.y;
+		state.angle = b->GetAngle();
+		state.vx = velocity.x;
+		state.vy = velocity.y;
+		state.angular_velocity = b->GetAngularVelocity();
+		state.sleep_time = b->GetSleepTime();
+		state.awake = b->IsAwake();
+		snapshot.bodies.push_back(state);
+	}
+
+	for (b2Joint* j = world->GetJointList(); j != NULL; j = j->GetNext())
+	{
+		const PhysBody* a = reinterpret_cast<PhysBody*>(j->GetBodyA()->GetUserData().pointer);
+		const PhysBody* b = reinterpret_cast<PhysBody*>(j->GetBodyB()->GetUserData().pointer);
+
+		if (j->GetType() != e_revoluteJoint || a == nullptr || b == nullptr)
+			continue;
+
+		const b2RevoluteJoint* joint = (const b2RevoluteJoint*)j;
+		JointSnapshot state;
+		state.serial_a = a->serial;
+		state.serial_b = b->serial;
+		state.motor_speed = joint->GetMotorSpeed();
+		state.motor_enabled = joint->IsMotorEnabled();
+
+		b2Vec2 impulse;
+		joint->GetImpulses(impulse, state.motor_impulse, state.lower_impulse, state.upper_impulse);
+		state.impulse_x = impulse.x;
+		state.impulse_y = impulse.y;
+		snapshot.joints.push_back(state);
+	}
+
+	for (b2Contact* c = world->GetContactList(); c != NULL; c = c->GetNext())
+	{
+		const b2Manifold* manifold = c->GetManifold();
+		const PhysBody* a = reinterpret_cast<PhysBody*>(c->GetFixtureA()->GetBody()->GetUserData().pointer);
+		const PhysBody* b = reinterpret_cast<PhysBody*>(c->GetFixtureB()->GetBody()->GetUserData().pointer);
+
+		if (c->IsTouching() == false || manifold->pointCount == 0 || a == nullptr || b == nullptr)
+			continue;
+
+		ContactSnapshot state;
+		state.serial_a = a->serial;
+		state.serial_b = b->serial;
+		state.child_a = c->GetChildIndexA();
+		state.child_b = c->GetChildIndexB();
+		state.point_count = manifold->pointCount;
+
+		for (int i = 0; i < manifold->pointCount; ++i)
+		{
+			state.ids[i] = manifold->points[i].id.key;
+			state.normal_impulses[i] = manifold->points[i].normalImpulse;
+			state.tangent_impulses[i] = manifold->points[i].tangentImpulse;
+		}
+
+		snapshot.contacts.push_back(state);
+	}
+
+	if (snapshot_listener != nullptr)
+		snapshot_listener->OnSaveSnapshot(snapshot.user, SNAPSHOT_USER_SIZE);
+}
+
+void ModulePhysics::RestoreSnapshot(const WorldSnapshot& snapshot)
+{
+	// Multiball worlds have hundreds of bodies and contacts, look them up by serial
+	std::unordered_map<uint, PhysBody*> by_serial;
+	by_serial.reserve(bodies.size());
+	for (PhysBody* pbody : bodies)
+		by_serial[pbody->serial] = pbody;
+
+	for (const BodySnapshot& state : snapshot.bodies)
+	{
+		auto found = by_serial.find(state.serial);
+		if (found == by_serial.end())
+			continue;
+
+		PhysBody* pbody = found->second;
+		b2Body* b = pbody->body;
+		b->SetTransform(b2Vec2(state.x, state.y), state.angle);
+		b->SetAwake(state.awake);
+		b->SetLinearVelocity(b2Vec2(state.vx, state.vy));
+		b->SetAngularVelocity(state.angular_velocity);
+		b->SetSleepTime(state.sleep_time);
+		pbody->ResetInterpolation();
+	}
+
+	// Joints created after the snapshot keep their state
+	for (b2Joint* j = world->GetJointList(); j != NULL; j = j->GetNext())
+	{
+		const PhysBody* a = reinterpret_cast<PhysBody*>(j->GetBodyA()->GetUserData().pointer);
+		const PhysBody* b = reinterpret_cast<PhysBody*>(j->GetBodyB()->GetUserData().pointer);
+
+		if (j->GetType() != e_revoluteJoint || a == nullptr || b == nullptr)
+			continue;
+
+		for (const JointSnapshot& state : snapshot.joints)
+		{
+			if (state.serial_a != a->serial || state.serial_b != b->serial)
+				continue;
+
+			b2RevoluteJoint* joint = (b2RevoluteJoint*)j;
+			joint->EnableMotor(state.motor_enabled);
+			joint->SetMotorSpeed(state.motor_speed);
+			joint->SetImpulses(b2Vec2(state.impulse_x, state.impulse_y), state.motor_impulse, state.lower_impulse, state.upper_impulse);
+			break;
+		}
+	}
+
+	std::unordered_multimap<uint64, const ContactSnapshot*> saved_contacts;
+	saved_contacts.reserve(snapshot.contacts.size());
+	for (const ContactSnapshot& state : snapshot.contacts)
+		saved_contacts.emplace(((uint64)state.serial_a << 32) | state.serial_b, &state);
+
+	// The next step matches its new manifold points with these by id to warm
+	// start, contacts the snapshot does not have start cold
+	for (b2Contact* c = world->GetContactList(); c != NULL; c = c->GetNext())
+	{
+		b2Manifold* manifold = c->GetManifold();
+		const PhysBody* a = reinterpret_cast<PhysBody*>(c->GetFixtureA()->GetBody()->GetUserData().pointer);
+		const PhysBody* b = reinterpret_cast<PhysBody*>(c->GetFixtureB()->GetBody()->GetUserData().pointer);
+		const ContactSnapshot* saved = nullptr;
+
+		if (a != nullptr && b != nullptr)
+		{
+			auto range = saved_contacts.equal_range(((uint64)a->serial << 32) | b->serial);
+
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (it->second->child_a == c->GetChildIndexA() && it->second->child_b == c->GetChildIndexB())
+				{
+					saved = it->second;
+					break;
+				}
+			}
+		}
+
+		manifold->pointCount = (saved != nullptr) ? saved->point_count : 0;
+
+		for (int i = 0; i < manifold->pointCount; ++i)
+		{
+			manifold->points[i].id.key = saved->ids[i];
+			manifold->points[i].normalImpulse = saved->normal_impulses[i];
+			manifold->points[i].tangentImpulse = saved->tangent_impulses[i];
+		}
+	}
+
+	step_count = snapshot.step;
+
+	if (snapshot_listener != nullptr)
+		snapshot_listener->OnRestoreSnapshot(snapshot.user, SNAPSHOT_USER_SIZE);
+}
+
+bool ModulePhysics::Rewind(uint steps)
+{
+	if (steps >= snapshots.GetCount())
+		return false;
+
+	for (uint i = 0; i < steps; ++i)
+		snapshots.Pop();
+
+	RestoreSnapshot(*snapshots.Get(0));
+	return true;
+}
+
+const SnapshotRing& ModulePhysics::GetSnapshots() const
+{
+	return snapshots;
+}
+
+void ModulePhysics::SetSnapshotListener(Module* listener)
+{
+	snapshot_listener = listener;
+}
+
+const b2Profile& ModulePhysics::GetFrameProfile() const
+{
+	return frame_profile;
+}
+
+int ModulePhysics::GetFrameSteps() const
+{
+	return frame_steps;
+}
+
+uint64 ModulePhysics::GetStepsTaken() const
+{
+	return steps_taken;
+}
+
 PhysBody* ModulePhysics::CreateCircle(int x, int y, int radius)
 {
 	PhysBody* pbody = new PhysBody();
@@ -62,15 +638,31 @@ PhysBody* ModulePhysics::CreateCircle(int x, int y, int radius)
 	pbody->body = b;
 	pbody->width = pbody->height = radius;
 
-	return pbody;
+	return TrackBody(pbody);
 }
 
 PhysBody* ModulePhysics::CreateRectangle(int x, int y, int width, int height)
+{
+	return CreateBox(x, y, width, height, b2_dynamicBody);
+}
+
+// Created with its final type, SetType afterwards would reinsert it in the broadphase
+PhysBody* ModulePhysics::CreateStaticRectangle(int x, int y, int width, int height)
+{
+	return CreateBox(x, y, width, height, b2_staticBody);
+}
+
+PhysBody* ModulePhysics::CreateKinematicRectangle(int x, int y, int width, int height)
+{
+	return CreateBox(x, y, width, height, b2_kinematicBody);
+}
+
+PhysBody* ModulePhysics::CreateBox(int x, int y, int width, int height, b2BodyType type)
 {
 	PhysBody* pbody = new PhysBody();
 
 	b2BodyDef body;
-	body.type = b2_dynamicBody;
+	body.type = type;
 	body.position.Set(PIXEL_TO_METERS(x), PIXEL_TO_METERS(y));
 	body.userData.pointer = reinterpret_cast<uintptr_t>(pbody);
 
@@ -88,7 +680,7 @@ PhysBody* ModulePhysics::CreateRectangle(int x, int y, int width, int height)
 	pbody->width = (int)(width * 0.5f);
 	pbody->height = (int)(height * 0.5f);
 
-	return pbody;
+	return TrackBody(pbody);
 }
 
 PhysBody* ModulePhysics::CreateRectangleSensor(int x, int y, int width, int height)
@@ -109,6 +701,7 @@ PhysBody* ModulePhysics::CreateRectangleSensor(int x, int y, int width, int heig
 	fixture.shape = &box;
 	fixture.density = 1.0f;
 	fixture.isSensor = true;
+	fixture.filter.categoryBits = PHYS_CATEGORY_SENSOR;
 
 	b->CreateFixture(&fixture);
 
@@ -116,49 +709,58 @@ PhysBody* ModulePhysics::CreateRectangleSensor(int x, int y, int width, int heig
 	pbody->width = width;
 	pbody->height = height;
 
-	return pbody;
+	return TrackBody(pbody);
 }
 
 PhysBody* ModulePhysics::CreateChain(int x, int y, const int* points, int size)
 {
 	if (size < 6 || size % 2 != 0) return nullptr;
+
+	b2Vec2* p = new b2Vec2[size / 2];
+
+	for(int i = 0; i < size / 2; ++i)
+	{
+		p[i].x = PIXEL_TO_METERS(x + points[i * 2 + 0]);
+		p[i].y = PIXEL_TO_METERS(y + points[i * 2 + 1]);
+	}
+
+	PhysBody* pbody = CreateChain(p, size / 2);
+
+	delete[] p;
+
+	return pbody;
+}
+
+PhysBody* ModulePhysics::CreateChain(const b2Vec2* vertices, int count)
+{
+	if (count < 3) return nullptr;
 	PhysBody* pbody = new PhysBody();
 
 	b2BodyDef body;
-	body.type = b2_dynamicBody;
-	body.position.Set(PIXEL_TO_METERS(x), PIXEL_TO_METERS(y));
+	body.type = b2_staticBody;
 	body.userData.pointer = reinterpret_cast<uintptr_t>(pbody);
 
 	b2Body* b = world->CreateBody(&body);
 
 	b2ChainShape shape;
-	b2Vec2* p = new b2Vec2[size / 2];
-
-	for(int i = 0; i < size / 2; ++i)
-	{
-		p[i].x = PIXEL_TO_METERS(points[i * 2 + 0]);
-		p[i].y = PIXEL_TO_METERS(points[i * 2 + 1]);
-	}
-
-	shape.CreateLoop(p, size / 2);
+	shape.CreateLoop(vertices, count);
 
 	b2FixtureDef fixture;
 	fixture.shape = &shape;
+	fixture.filter.categoryBits = PHYS_CATEGORY_WALL;
 
 	b->CreateFixture(&fixture);
 
-	delete[] p;
-
 	pbody->body = b;
 	pbody->width = pbody->height = 0;
 
-	return pbody;
+	return TrackBody(pbody);
 }
 
 // 
 update_status ModulePhysics::PostUpdate()
 {
-	if (IsKeyPressed(KEY_F1))
+	if (App->input->IsKeyPressed(KEY_F1))
 	{
 		debug =!debug;;
 	}
@@ -168,90 +770,27 @@ update_status ModulePhysics::PostUpdate()
 		return UPDATE_CONTINUE;
 	}
 
-	b2Body* mouseSelect = nullptr;
-	Vector2 mousePosition = GetMousePosition();
-	b2Vec2 pMousePosition = b2Vec2(PIXEL_TO_METERS(mousePosition.x), PIXEL_TO_METERS(mousePosition.y));
-
-	// Bonus code: this will iterate all objects in the world and draw the circles
-	// You need to provide your own macro to translate meters to pixels
-	for(b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	if (App->IsHeadless() == false)
 	{
-		for(b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
-		{
-			switch(f->GetType())
-			{
-				// Draw circles ------------------------------------------------
-				case b2Shape::e_circle:
-				{
-					b2CircleShape* shape = (b2CircleShape*)f->GetShape();
-					b2Vec2 pos = f->GetBody()->GetPosition();
-					
-					DrawCircle(METERS_TO_PIXELS(pos.x), METERS_TO_PIXELS(pos.y), (float)METERS_TO_PIXELS(shape->m_radius), Color{0, 0, 0, 128});
-				}
-				break;
+		// F2 adds the broadphase AABBs
+		if (App->input->IsKeyPressed(KEY_F2))
+			debug_draw.SetShowAABBs(!debug_draw.GetShowAABBs());
 
-				// Draw polygons ------------------------------------------------
-				case b2Shape::e_polygon:
-				{
-					b2PolygonShape* polygonShape = (b2PolygonShape*)f->GetShape();
-					int32 count = polygonShape->m_count;
-					b2Vec2 prev, v;
-
-					for(int32 i = 0; i < count; ++i)
-					{
-						v = b->GetWorldPoint(polygonShape->m_vertices[i]);
-						if(i > 0)
-							DrawLine(METERS_TO_PIXELS(prev.x), METERS_TO_PIXELS(prev.y), METERS_TO_PIXELS(v.x), METERS_TO_PIXELS(v.y), RED);
-
-						prev = v;
-					}
-
-					v = b->GetWorldPoint(polygonShape->m_vertices[0]);
-					DrawLine(METERS_TO_PIXELS(prev.x), METERS_TO_PIXELS(prev.y), METERS_TO_PIXELS(v.x), METERS_TO_PIXELS(v.y), RED);
-				}
-				break;
-
-				// Draw chains contour -------------------------------------------
-				case b2Shape::e_chain:
-				{
-					b2ChainShape* shape = (b2ChainShape*)f->GetShape();
-					b2Vec2 prev, v;
-
-					for(int32 i = 0; i < shape->m_count; ++i)
-					{
-						v = b->GetWorldPoint(shape->m_vertices[i]);
-						if(i > 0)
-							DrawLine(METERS_TO_PIXELS(prev.x), METERS_TO_PIXELS(prev.y), METERS_TO_PIXELS(v.x), METERS_TO_PIXELS(v.y), GREEN);
-						prev = v;
-					}
-
-					v = b->GetWorldPoint(shape->m_vertices[0]);
-					DrawLine(METERS_TO_PIXELS(prev.x), METERS_TO_PIXELS(prev.y), METERS_TO_PIXELS(v.x), METERS_TO_PIXELS(v.y), GREEN);
-				}
-				break;
-
-				// Draw a single segment(edge) ----------------------------------
-				case b2Shape::e_edge:
-				{
-					b2EdgeShape* shape = (b2EdgeShape*)f->GetShape();
-					b2Vec2 v1, v2;
+		debug_draw.Draw(world, Rectangle{ 0.0f, 0.0f, (float)GetScreenWidth(), (float)GetScreenHeight() });
+	}
 
-					v1 = b->GetWorldPoint(shape->m_vertex0);
-					v1 = b->GetWorldPoint(shape->m_vertex1);
-					DrawLine(METERS_TO_PIXELS(v1.x), METERS_TO_PIXELS(v1.y), METERS_TO_PIXELS(v2.x), METERS_TO_PIXELS(v2.y), BLUE);
-				}
-				break;
-			}
+	b2Body* mouseSelect = nullptr;
+	Vector2 mousePosition = App->input->GetMousePosition();
+	b2Vec2 pMousePosition = b2Vec2(PIXEL_TO_METERS(mousePosition.x), PIXEL_TO_METERS(mousePosition.y));
 
-			// TODO 1: If mouse button 1 is pressed ...
-			// test if the current body contains mouse position
-			if (mouse_joint == nullptr && mouseSelect == nullptr && IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-				
-				if (f->TestPoint(pMousePosition)) {
-					mouseSelect = b;
-				}
-			}
-		}
+	// TODO 1: If mouse button 1 is pressed ...
+	// test if the current body contains mouse position
+	if (mouse_joint == nullptr && App->input->IsMouseButtonDown(MOUSE_BUTTON_LEFT))
+	{
+		// Only dynamic bodies can be dragged by the mouse joint
+		PhysBody* picked = QueryPoint((int)mousePosition.x, (int)mousePosition.y);
+		if (picked != nullptr && picked->body->GetType() == b2_dynamicBody)
+			mouseSelect = picked->body;
 	}
 
 	if (mouseSelect) {
@@ -269,17 +808,21 @@ update_status ModulePhysics::PostUpdate()
 
 	// TODO 3: If the player keeps pressing the mouse button, update
 	// target position and draw a red line between both anchor points
-	else if (mouse_joint && IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+	else if (mouse_joint && App->input->IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
 		mouse_joint->SetTarget(pMousePosition);
-		b2Vec2 anchorPosition = mouse_joint->GetBodyB()->GetPosition();
-		anchorPosition.x = METERS_TO_PIXELS(anchorPosition.x);
-		anchorPosition.y = METERS_TO_PIXELS(anchorPosition.y);
-		
-		DrawLine(anchorPosition.x, anchorPosition.y, mousePosition.x, mousePosition.y, RED);
+
+		if (App->IsHeadless() == false)
+		{
+			b2Vec2 anchorPosition = mouse_joint->GetBodyB()->GetPosition();
+			anchorPosition.x = METERS_TO_PIXELS(anchorPosition.x);
+			anchorPosition.y = METERS_TO_PIXELS(anchorPosition.y);
+
+			DrawLine(anchorPosition.x, anchorPosition.y, mousePosition.x, mousePosition.y, RED);
+		}
 	}
 
 	// TODO 4: If the player releases the mouse button, destroy the joint
-	else if (mouse_joint && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+	else if (mouse_joint && App->input->IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
 		world->DestroyJoint(mouse_joint);
 		mouse_joint = nullptr;
 	}
@@ -287,15 +830,30 @@ update_status ModulePhysics::PostUpdate()
 	return UPDATE_CONTINUE;
 }
 
-
 // Called before quitting
 bool ModulePhysics::CleanUp()
 {
 	LOG("Destroying physics world");
 
+	for (PhysBody* pbody : bodies)
+	{
+		delete pbody;
+	}
+	bodies.clear();
+	step_listeners.clear();
+	contact_events.clear();
+	begin_events.clear();
+	step_impulses.clear();
+
 	// Delete the whole physics world!
 	delete world;
 
+	if (parallel)
+	{
+		LOG("Physics workers stole %llu tasks", (unsigned long long)workers.GetStolenCount());
+		workers.Stop();
+	}
+
 	return true;
 }
 
@@ -311,6 +869,23 @@ float PhysBody::GetRotation() const
 	return body->GetAngle();
 }
 
+void PhysBody::GetRenderPosition(int& x, int& y) const
+{
+	x = METERS_TO_PIXELS(render_position.x);
+	y = METERS_TO_PIXELS(render_position.y);
+}
+
+float PhysBody::GetRenderRotation() const
+{
+	return render_angle;
+}
+
+void PhysBody::ResetInterpolation()
+{
+	prev_position = render_position = body->GetPosition();
+	prev_angle = render_angle = body->GetAngle();
+}
+
 bool PhysBody::Contains(int x, int y) const
 {
 	b2Vec2 p(PIXEL_TO_METERS(x), PIXEL_TO_METERS(y));
@@ -342,18 +917,21 @@ int PhysBody::RayCast(int x1, int y1, int x2, int y2, float& normal_x, float& no
 
 	while(fixture != NULL)
 	{
-		if(fixture->GetShape()->RayCast(&output, input, body->GetTransform(), 0) == true)
+		// Every child of a chain, keeping the nearest hit
+		for (int32 child = 0; child < fixture->GetShape()->GetChildCount(); ++child)
 		{
-			// do we want the normal ?
-
-			float fx = (float)(x2 - x1);
-			float fy = (float)(y2 - y1);
-			float dist = sqrtf((fx*fx) + (fy*fy));
+			if(fixture->GetShape()->RayCast(&output, input, body->GetTransform(), child) == true)
+			{
+				float fx = (float)(x2 - x1);
+				float fy = (float)(y2 - y1);
+				float dist = sqrtf((fx*fx) + (fy*fy));
 
-			normal_x = output.normal.x;
-			normal_y = output.normal.y;
+				normal_x = output.normal.x;
+				normal_y = output.normal.y;
 
-			return (int)(output.fraction * dist);
+				ret = (int)(output.fraction * dist);
+				input.maxFraction = output.fraction;
+			}
 		}
 		fixture = fixture->GetNext();
 	}
@@ -361,22 +939,126 @@ int PhysBody::RayCast(int x1, int y1, int x2, int y2, float& normal_x, float& no
 	return ret;
 }
 
+void PhysBody::SetCategory(uint16 category)
+{
+	for (b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+	{
+		b2Filter filter = fixture->GetFilterData();
+		filter.categoryBits = category;
+		fixture->SetFilterData(filter);
+	}
+}
+
 void ModulePhysics::BeginContact(b2Contact* contact)
 {
-	b2BodyUserData dataA = contact->GetFixtureA()->GetBody()->GetUserData();
-	b2BodyUserData dataB = contact->GetFixtureB()->GetBody()->GetUserData();
+	RecordContact(ContactEvent::BEGIN, contact);
+}
 
-	PhysBody* physA = (PhysBody*)dataA.pointer;
-	PhysBody* physB = (PhysBody*)dataB.pointer;
+void ModulePhysics::EndContact(b2Contact* contact)
+{
+	RecordContact(ContactEvent::END, contact);
+}
+
+// Called for every touching contact each step. Only keeps the impulse, a contact
+// always begins before its first PostSolve so none is kept until one began
+void ModulePhysics::PostSolve(b2Contact* contact, const b2ContactImpulse* impulse)
+{
+	if (begin_events.empty())
+		return;
 
-	if(physA && physA->listener != NULL)
-		physA->listener->OnCollision(physA, physB);
+	ContactImpulse record;
+	record.contact = contact;
+	record.impulse = 0.0f;
 
-	if(physB && physB->listener != NULL)
-		physB->listener->OnCollision(physB, physA);
-	
+	for (int32 p = 0; p < impulse->count; ++p)
+		record.impulse = MAX(record.impulse, impulse->normalImpulses[p]);
+
+	step_impulses.push_back(record);
+}
 
+void ModulePhysics::RecordContact(ContactEvent::Type type, b2Contact* contact)
+{
+	ContactEvent event;
+	event.type = type;
+	event.body_a = (PhysBody*)contact->GetFixtureA()->GetBody()->GetUserData().pointer;
+	event.body_b = (PhysBody*)contact->GetFixtureB()->GetBody()->GetUserData().pointer;
+	event.impulse = 0.0f;
+
+	// Nobody listens to this pair
+	if ((event.body_a == nullptr || event.body_a->listener == nullptr) &&
+		(event.body_b == nullptr || event.body_b->listener == nullptr))
+		return;
+
+	if (type == ContactEvent::BEGIN)
+	{
+		ContactBegin begin;
+		begin.contact = contact;
+		begin.event = (uint)contact_events.size();
+		begin_events.push_back(begin);
+	}
+
+	contact_events.push_back(event);
+}
+
+// The begin events are sorted once after the step, each impulse then finds its
+// contact with a binary search. The first begin of a contact gets its impulse
+void ModulePhysics::MatchImpulses()
+{
+	if (begin_events.empty() == false && step_impulses.empty() == false)
+	{
+		std::sort(begin_events.begin(), begin_events.end(), [](const ContactBegin& a, const ContactBegin& b)
+			{ return a.contact != b.contact ? a.contact < b.contact : a.event < b.event; });
+
+		for (const ContactImpulse& record : step_impulses)
+		{
+			auto found = std::lower_bound(begin_events.begin(), begin_events.end(), record.contact,
+				[](const ContactBegin& begin, const b2Contact* contact) { return begin.contact < contact; });
+
+			if (found != begin_events.end() && found->contact == record.contact)
+			{
+				ContactEvent& event = contact_events[found->event];
+				event.impulse = MAX(event.impulse, record.impulse);
+			}
+		}
+	}
+
+	begin_events.clear();
+	step_impulses.clear();
+}
+
+// Listeners may destroy bodies (DestroyBody clears them from the remaining
+// events) or raise new events, so index the vector instead of iterating it
+void ModulePhysics::DispatchContacts()
+{
+	SCOPED_TIMER(contact_stat);
+
+	for (uint i = 0; i < contact_events.size(); ++i)
+	{
+		ContactEvent event = contact_events[i];
+
+		if (event.body_a == nullptr || event.body_b == nullptr)
+			continue;
+
+		if (event.type == ContactEvent::BEGIN)
+		{
+			if (event.body_a->listener != NULL)
+				event.body_a->listener->OnCollision(event.body_a, event.body_b, event.impulse);
+
+			// Puede haberse destruido en el callback anterior
+			if (contact_events[i].body_a != nullptr && contact_events[i].body_b != nullptr && event.body_b->listener != NULL)
+				event.body_b->listener->OnCollision(event.body_b, event.body_a, event.impulse);
+		}
+		else
+		{
+			if (event.body_a->listener != NULL)
+				event.body_a->listener->OnCollisionEnd(event.body_a, event.body_b);
+
+			if (contact_events[i].body_a != nullptr && contact_events[i].body_b != nullptr && event.body_b->listener != NULL)
+				event.body_b->listener->OnCollisionEnd(event.body_b, event.body_a);
+		}
+	}
 
+	contact_events.clear();
 }
 b2RevoluteJoint* ModulePhysics::CreateJoint(b2RevoluteJointDef* def)
 {
@@ -2,6 +2,12 @@
 
 #include "Module.h"
 #include "Globals.h"
+#include "Timer.h"
+#include "DebugDraw.h"
+#include "SnapshotRing.h"
+#include "WorkerPool.h"
+
+#include <vector>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -22,11 +28,18 @@
 #define METERS_TO_PIXELS(m) ((int) floor(PIXELS_PER_METER * m))
 #define PIXEL_TO_METERS(p)  ((float) METER_PER_PIXEL * p)
 
+// Fixture category bits, used to filter queries. Collisions are not
+// filtered: every category keeps colliding with all the others
+#define PHYS_CATEGORY_DEFAULT	0x0001
+#define PHYS_CATEGORY_WALL		0x0002
+#define PHYS_CATEGORY_SENSOR	0x0004
+#define PHYS_CATEGORY_ALL		0xFFFF
+
 // Small class to return to other modules to track position and rotation of physics bodies
 class PhysBody
 {
 public:
-	PhysBody() : width(0), height(0), body(NULL), listener(NULL)
+	PhysBody() : width(0), height(0), body(NULL), listener(NULL), index(-1), serial(0), prev_position(b2Vec2_zero), prev_angle(0.0f), render_position(b2Vec2_zero), render_angle(0.0f)
 	{}
 
 	//void GetPosition(int& x, int& y) const;
@@ -34,12 +47,76 @@ public:
 	float GetRotation() const;
 	bool Contains(int x, int y) const;
 	int RayCast(int x1, int y1, int x2, int y2, float& normal_x, float& normal_y) const;
+	void SetCategory(uint16 category);
+
+	// Position and rotation interpolated between the last two physics steps, use them to draw
+	void GetRenderPosition(int& x, int& y) const;
+	float GetRenderRotation() const;
+
+	// Call after teleporting the body so it is not drawn sliding from its old position
+	void ResetInterpolation();
 
 public:
 	int width, height;
 	b2Body* body;
 	Module* listener;
 
+	// Position in ModulePhysics::bodies
+	int index;
+	// Creation order, later bodies are on top when picking
+	uint serial;
+
+	b2Vec2 prev_position;
+	float prev_angle;
+	b2Vec2 render_position;
+	float render_angle;
+};
+
+// Result of a world raycast, positions and distance in pixels
+struct RayHit
+{
+	PhysBody* body = nullptr;
+	int x = 0, y = 0;
+	float normal_x = 0.0f, normal_y = 0.0f;
+	float fraction = 0.0f;
+	int distance = 0;
+};
+
+struct RaySegment
+{
+	int x1, y1;
+	int x2, y2;
+};
+
+#define CONTACT_EVENTS_RESERVE	256
+#define CONTACT_IMPULSES_RESERVE	1024
+#define SNAPSHOT_RING_SIZE		300	// steps kept to rewind, 5 s at 60 Hz
+
+// Contact recorded during a world step and dispatched to the listeners once the
+// step is over. impulse is the largest normal impulse the solver applied to the
+// pair in that step (N*s), zero for sensors and end events
+struct ContactEvent
+{
+	enum Type { BEGIN, END };
+
+	Type type;
+	PhysBody* body_a;
+	PhysBody* body_b;
+	float impulse;
+};
+
+// Begin event a contact raised in the step being solved
+struct ContactBegin
+{
+	b2Contact* contact;
+	uint event;
+};
+
+// Largest normal impulse PostSolve reported for a contact in the step being solved
+struct ContactImpulse
+{
+	b2Contact* contact;
+	float impulse;
 };
 
 // Module --------------------------------------
@@ -56,18 +133,112 @@ public:
 
 	PhysBody* CreateCircle(int x, int y, int radius);
 	PhysBody* CreateRectangle(int x, int y, int width, int height);
+	PhysBody* CreateStaticRectangle(int x, int y, int width, int height);
+	PhysBody* CreateKinematicRectangle(int x, int y, int width, int height);
 	PhysBody* CreateRectangleSensor(int x, int y, int width, int height);
 	PhysBody* CreateChain(int x, int y, const int* points, int size);
+	// Closed chain from vertices already in meters, they are copied by Box2D
+	PhysBody* CreateChain(const b2Vec2* vertices, int count);
 	/*PhysBody* circleBody;*/
 	b2RevoluteJoint* CreateJoint(b2RevoluteJointDef* def);
+
+	// Create the table's static geometry between these two calls, before the first
+	// step. EndTableBuild rebuilds the broadphase tree top down in one go
+	void BeginTableBuild();
+	void EndTableBuild();
+
+	// Destroys the body and frees pbody, do not call it during a world step
+	void DestroyBody(PhysBody* pbody);
+
+	// Bodies with a fixture containing the point (in pixels), candidates come
+	// from the broadphase. QueryPoint returns the topmost one: dynamic before
+	// kinematic before static, then the most recently created
+	PhysBody* QueryPoint(int x, int y, bool include_sensors = false) const;
+	uint QueryPointAll(int x, int y, std::vector<PhysBody*>& result, bool include_sensors = false) const;
+
+	// Raycasts against every fixture whose category is in mask, through the broadphase.
+	// RayCast keeps the nearest hit, RayCastAll every hit sorted by distance and
+	// RayCastBatch the nearest hit of each ray (body stays nullptr on a miss)
+	bool RayCast(int x1, int y1, int x2, int y2, RayHit& hit, uint16 mask = PHYS_CATEGORY_ALL) const;
+	uint RayCastAll(int x1, int y1, int x2, int y2, std::vector<RayHit>& hits, uint16 mask = PHYS_CATEGORY_ALL) const;
+	uint RayCastBatch(const RaySegment* rays, uint count, RayHit* hits, uint16 mask = PHYS_CATEGORY_ALL) const;
 	// b2ContactListener ---
+	// Only record events, listeners are called from DispatchContacts
 	void BeginContact(b2Contact* contact);
+	void EndContact(b2Contact* contact);
+	void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse);
+
+	// Run the narrow phase and solve the islands of each step on this many threads, 0 uses every hardware
+	// thread. Off unless called before Start
+	void SetWorkerThreads(uint threads);
+
+	// Fixed timestep
+	void SetStepRate(float hz);
+	float GetStepTime() const;
+	void AddStepListener(Module* listener);
+
+	// b2World::GetProfile() summed over the steps taken this frame
+	const b2Profile& GetFrameProfile() const;
+	int GetFrameSteps() const;
+	// World steps taken since the module was created, rewinds do not take them back
+	uint64 GetStepsTaken() const;
+
+	// Dynamic and kinematic bodies, revolute joint motors and contact impulses
+	void SaveSnapshot(WorldSnapshot& snapshot);
+	// Bodies destroyed since the snapshot are not brought back, newer ones are left as they are
+	void RestoreSnapshot(const WorldSnapshot& snapshot);
+	// A snapshot goes into the ring after every step. Rewind restores the one from
+	// steps steps ago and drops the newer ones, false if the ring is not that long
+	bool Rewind(uint steps);
+	const SnapshotRing& GetSnapshots() const;
+	// Adds its OnSaveSnapshot state to every snapshot
+	void SetSnapshotListener(Module* listener);
+
+private:
+
+	PhysBody* TrackBody(PhysBody* pbody);
+	PhysBody* CreateBox(int x, int y, int width, int height, b2BodyType type);
+	void InterpolateBodies(float alpha);
+	void RecordContact(ContactEvent::Type type, b2Contact* contact);
+	void MatchImpulses();
+	void DispatchContacts();
 
-	
 private:
 
 	bool debug;
+	DebugDraw debug_draw;
 	b2World* world;
 	b2MouseJoint* mouse_joint;
 	b2Body* ground;
+
+	uint next_serial;
+
+	bool table_build;
+	int table_statics;
+
+	float step_time;
+	float accumulator;
+	uint step_count;
+	uint64 steps_taken;
+	b2Profile frame_profile;
+	int frame_steps;
+
+	// Events of the current step, the vectors keep their capacity between steps.
+	// PostSolve only appends to step_impulses, MatchImpulses hands the impulses
+	// to the begin events once the step is over
+	std::vector<ContactEvent> contact_events;
+	std::vector<ContactBegin> begin_events;
+	std::vector<ContactImpulse> step_impulses;
+
+	// Time spent dispatching contact events, including listeners
+	TimeStat contact_stat;
+	std::vector<PhysBody*> bodies;
+	std::vector<Module*> step_listeners;
+
+	bool parallel;
+	uint worker_threads;
+	WorkerPool workers;
+
+	SnapshotRing snapshots;
+	Module* snapshot_listener;
 };
\ No newline at end of file
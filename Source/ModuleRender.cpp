@@ -2,11 +2,21 @@
 #include "Application.h"
 #include "ModuleWindow.h"
 #include "ModuleRender.h"
+#include "ModuleInput.h"
+#include "rlgl.h"
+
 #include <math.h>
+#include <algorithm>
 
 ModuleRender::ModuleRender(Application* app, bool start_enabled) : Module(app, start_enabled)
 {
     background = RAYWHITE;
+	show_profiler = false;
+
+	frame_sprites = 0;
+	frame_sprite_groups = 0;
+	sprite_count = 0;
+	sprite_groups = 0;
 }
 
 // Destructor
@@ -19,42 +29,113 @@ bool ModuleRender::Init()
 	LOG("Creating Renderer context");
 	bool ret = true;
 
+	sprites.reserve(SPRITE_BATCH_RESERVE);
+
 	return ret;
 }
 
 // PreUpdate: clear buffer
 update_status ModuleRender::PreUpdate()
 {
+    // NOTE: This function setups render batching system for
+    // maximum performance, all consecutive Draw() calls are
+    // not processed until EndDrawing() is called
+    BeginDrawing();
+
+    // Before any module Update draws, otherwise a batch flushed early gets cleared
+    ClearBackground(background);
+
 	return UPDATE_CONTINUE;
 }
 
 // Update: debug camera
 update_status ModuleRender::Update()
 {
-    ClearBackground(background);
-
-    // NOTE: This function setups render batching system for
-    // maximum performance, all consecutive Draw() calls are
-    // not processed until EndDrawing() is called
-    BeginDrawing();
-
 	return UPDATE_CONTINUE;
 }
 
 // PostUpdate present buffer to screen
 update_status ModuleRender::PostUpdate()
 {
+    if (App->input->IsKeyPressed(KEY_F3)) show_profiler = !show_profiler;
+    if (App->input->IsKeyPressed(KEY_F4)) App->profiler.DumpCSV(PROFILER_CSV_PATH);
+
+    FlushSprites();
+    frame_sprites = sprite_count;
+    frame_sprite_groups = sprite_groups;
+    sprite_count = 0;
+    sprite_groups = 0;
+
     // Draw everything in our batch!
     DrawFPS(10, 10);
 
+    if (show_profiler) DrawProfiler();
+
     EndDrawing();
 
 	return UPDATE_CONTINUE;
 }
 
+// Timings of the last completed frame, under the FPS counter
+void ModuleRender::DrawProfiler() const
+{
+	const FrameProfile& frame = App->profiler.GetLastFrame();
+	const int font_size = 10;
+	const int line = font_size + 2;
+	int x = 10;
+	int y = 32;
+
+	DrawRectangle(x - 4, y - 4, 230, line * (App->profiler.GetModuleCount() + App->profiler.GetStatCount() + 12) + 8, Color{ 0, 0, 0, 160 });
+
+	::DrawText(TextFormat("frame %.3f ms", frame.frame_ms), x, y, font_size, LIME);
+	y += line;
+
+	for (int m = 0; m < App->profiler.GetModuleCount(); ++m)
+	{
+		::DrawText(TextFormat("%-9s %.3f / %.3f / %.3f", App->profiler.GetModuleName(m),
+			frame.module_ms[m][PROFILE_PRE_UPDATE], frame.module_ms[m][PROFILE_UPDATE], frame.module_ms[m][PROFILE_POST_UPDATE]), x, y, font_size, WHITE);
+		y += line;
+	}
+
+	y += line;
+	::DrawText(TextFormat("b2World %d step(s)", frame.physics_steps), x, y, font_size, LIME);
+	y += line;
+	::DrawText(TextFormat("step       %.3f ms", frame.step_ms), x, y, font_size, WHITE);
+	y += line;
+	::DrawText(TextFormat("collide    %.3f ms", frame.collide_ms), x, y, font_size, WHITE);
+	y += line;
+	::DrawText(TextFormat("solve      %.3f ms", frame.solve_ms), x, y, font_size, WHITE);
+	y += line;
+	::DrawText(TextFormat("solveTOI   %.3f ms", frame.solve_toi_ms), x, y, font_size, WHITE);
+	y += line;
+	::DrawText(TextFormat("broadphase %.3f ms", frame.broadphase_ms), x, y, font_size, WHITE);
+	y += line;
+
+	y += line;
+	::DrawText(TextFormat("sprites %u in %u group(s)", frame_sprites, frame_sprite_groups), x, y, font_size, LIME);
+	y += line;
+
+	// Scoped timer statistics: count, mean and max in milliseconds
+	for (int i = 0; i < App->profiler.GetStatCount(); ++i)
+	{
+		const TimeStat* stat = App->profiler.GetStat(i);
+		y += line;
+		::DrawText(TextFormat("%s x%llu %.4f / %.4f ms", stat->GetName(), (unsigned long long)stat->GetCount(), stat->GetMeanMs(), stat->GetMaxMs()), x, y, font_size, WHITE);
+	}
+}
+
 // Called before quitting
 bool ModuleRender::CleanUp()
 {
+	atlas.Unload();
+
+	for (Texture2D& texture : loose_textures)
+	{
+		if (texture.id != 0)
+			UnloadTexture(texture);
+	}
+	loose_textures.clear();
+
 	return true;
 }
 
@@ -63,9 +144,113 @@ void ModuleRender::SetBackgroundColor(Color color)
 	background = color;
 }
 
+// Load a texture, without a GL context (headless) only its size is read
+Texture2D ModuleRender::LoadTexture(const char* path) const
+{
+	if (App->IsHeadless() == false)
+		return ::LoadTexture(path);
+
+	Texture2D texture{};
+	Image image = LoadImage(path);
+
+	texture.width = image.width;
+	texture.height = image.height;
+	texture.mipmaps = image.mipmaps;
+	texture.format = image.format;
+
+	UnloadImage(image);
+
+	return texture;
+}
+
+void ModuleRender::LoadTextureAsync(const char* path, Texture2D* texture) const
+{
+	bool headless = App->IsHeadless();
+
+	App->assets.LoadImageAsync(path, [texture, headless](const Image& image)
+	{
+		if (image.data == NULL)
+			return;
+
+		if (headless == false)
+		{
+			*texture = LoadTextureFromImage(image);
+			return;
+		}
+
+		texture->width = image.width;
+		texture->height = image.height;
+		texture->mipmaps = image.mipmaps;
+		texture->format = image.format;
+	});
+}
+
+bool ModuleRender::LoadAtlas(const char* const* paths, int count, std::function<void()> on_upload, bool rebuild)
+{
+	return atlas.Load(paths, count, ATLAS_CACHE_PATH, App->IsHeadless(), &App->assets, on_upload, rebuild);
+}
+
+AtlasRegion ModuleRender::GetRegion(const char* path)
+{
+	AtlasRegion region;
+
+	if (atlas.Find(path, region) == false)
+	{
+		region.texture = LoadTexture(path);
+		region.section = Rectangle{ 0.0f, 0.0f, (float)region.texture.width, (float)region.texture.height };
+		loose_textures.push_back(region.texture);
+	}
+
+	return region;
+}
+
+bool ModuleRender::ReloadTexture(Texture2D& texture, const char* path)
+{
+	Image image = LoadImage(path);
+	if (image.data == NULL)
+		return false;
+
+	if (App->IsHeadless())
+	{
+		texture.width = image.width;
+		texture.height = image.height;
+	}
+	else if (texture.id != 0 && image.width == texture.width && image.height == texture.height && texture.mipmaps == 1)
+	{
+		ImageFormat(&image, texture.format);
+		UpdateTexture(texture, image.data);
+	}
+	else
+	{
+		Texture2D loaded = LoadTextureFromImage(image);
+
+		for (Texture2D& loose : loose_textures)
+		{
+			if (texture.id != 0 && loose.id == texture.id)
+				loose = loaded;
+		}
+
+		if (texture.id != 0)
+			UnloadTexture(texture);
+
+		texture = loaded;
+	}
+
+	UnloadImage(image);
+	return true;
+}
+
+bool ModuleRender::ReloadAtlasSprite(const char* path)
+{
+	return atlas.UpdateSprite(path, App->IsHeadless());
+}
+
 // Draw to screen
 bool ModuleRender::Draw(Texture2D texture, int x, int y, const Rectangle* section, double angle, int pivot_x, int pivot_y) const
 {
+	if (IsEnabled() == false)
+		return false;
+
 	bool ret = true;
 
 	float scale = 1.0f;
@@ -87,6 +272,9 @@ bool ModuleRender::Draw(Texture2D texture, int x, int y, const Rectangle* sectio
 
 bool ModuleRender::DrawText(const char * text, int x, int y, Font font, int spacing, Color tint) const
 {
+    if (IsEnabled() == false)
+        return false;
+
     bool ret = true;
 
     Vector2 position = { (float)x, (float)y };
@@ -95,3 +283,106 @@ bool ModuleRender::DrawText(const char * text, int x, int y, Font font, int spac
 
     return ret;
 }
+
+bool ModuleRender::DrawSprite(Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin, float rotation, int layer, Color tint)
+{
+	if (IsEnabled() == false || texture.id == 0)
+		return false;
+
+	Sprite sprite;
+	sprite.texture = texture;
+	sprite.source = source;
+	sprite.dest = dest;
+	sprite.origin = origin;
+	sprite.rotation = rotation;
+	sprite.tint = tint;
+	sprite.layer = layer;
+
+	sprites.push_back(sprite);
+
+	return true;
+}
+
+// Same quad as DrawTexturePro, but one rlBegin/rlEnd per texture group
+// instead of one per sprite. rlgl only flushes when its vertex buffer fills
+void ModuleRender::FlushSprites()
+{
+	if (sprites.empty())
+		return;
+
+	// Stable: sprites with the same layer and texture keep their submission order
+	std::stable_sort(sprites.begin(), sprites.end(), [](const Sprite& a, const Sprite& b)
+	{
+		if (a.layer != b.layer) return a.layer < b.layer;
+		return a.texture.id < b.texture.id;
+	});
+
+	uint texture_id = 0;
+
+	for (const Sprite& sprite : sprites)
+	{
+		if (sprite.texture.id != texture_id)
+		{
+			if (texture_id != 0)
+			{
+				rlEnd();
+			}
+
+			texture_id = sprite.texture.id;
+			rlSetTexture(texture_id);
+			rlBegin(RL_QUADS);
+			rlNormal3f(0.0f, 0.0f, 1.0f);
+			sprite_groups++;
+		}
+
+		float width = (float)sprite.texture.width;
+		float height = (float)sprite.texture.height;
+
+		Rectangle source = sprite.source;
+		bool flip_x = false;
+		if (source.width < 0) { flip_x = true; source.width *= -1; }
+		if (source.height < 0) source.y -= source.height;
+
+		const Rectangle& dest = sprite.dest;
+		float dx = -sprite.origin.x;
+		float dy = -sprite.origin.y;
+		float c = 1.0f, s = 0.0f;
+
+		if (sprite.rotation != 0.0f)
+		{
+			c = cosf(sprite.rotation * DEG2RAD);
+			s = sinf(sprite.rotation * DEG2RAD);
+		}
+
+		Vector2 top_left = { dest.x + dx * c - dy * s, dest.y + dx * s + dy * c };
+		Vector2 top_right = { dest.x + (dx + dest.width) * c - dy * s, dest.y + (dx + dest.width) * s + dy * c };
+		Vector2 bottom_left = { dest.x + dx * c - (dy + dest.height) * s, dest.y + dx * s + (dy + dest.height) * c };
+		Vector2 bottom_right = { dest.x + (dx + dest.width) * c - (dy + dest.height) * s, dest.y + (dx + dest.width) * s + (dy + dest.height) * c };
+
+		float u0 = source.x / width;
+		float u1 = (source.x + source.width) / width;
+		float v0 = source.y / height;
+		float v1 = (source.y + source.height) / height;
+		if (flip_x) std::swap(u0, u1);
+
+		rlColor4ub(sprite.tint.r, sprite.tint.g, sprite.tint.b, sprite.tint.a);
+
+		rlTexCoord2f(u0, v0);
+		rlVertex2f(top_left.x, top_left.y);
+
+		rlTexCoord2f(u0, v1);
+		rlVertex2f(bottom_left.x, bottom_left.y);
+
+		rlTexCoord2f(u1, v1);
+		rlVertex2f(bottom_right.x, bottom_right.y);
+
+		rlTexCoord2f(u1, v0);
+		rlVertex2f(top_right.x, top_right.y);
+	}
+
+	rlEnd();
+	rlSetTexture(0);
+
+	sprite_count += (uint)sprites.size();
+	sprites.clear();
+}
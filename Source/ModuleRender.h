@@ -1,8 +1,24 @@
 #pragma once
 #include "Module.h"
 #include "Globals.h"
+#include "TextureAtlas.h"
 
 #include <limits.h>
+#include <vector>
+
+#define SPRITE_BATCH_RESERVE 4096
+
+// A textured quad waiting in the sprite batch, same parameters as DrawTexturePro
+struct Sprite
+{
+	Texture2D texture;
+	Rectangle source;
+	Rectangle dest;
+	Vector2 origin;
+	float rotation;
+	Color tint;
+	int layer;
+};
 
 class ModuleRender : public Module
 {
@@ -17,11 +33,54 @@ public:
 	bool CleanUp();
 
     void SetBackgroundColor(Color color);
+	Texture2D LoadTexture(const char* path) const;
+	// Decoded in the background, texture is filled on the main thread some frames later
+	void LoadTextureAsync(const char* path, Texture2D* texture) const;
+
+	// Packs the images into the sprite atlas, cached in ATLAS_CACHE_PATH. A
+	// cached atlas is uploaded in the background: its regions are ready on
+	// return but their texture arrives later, on_upload is the time to get them again.
+	// rebuild ignores the cache
+	bool LoadAtlas(const char* const* paths, int count, std::function<void()> on_upload = nullptr, bool rebuild = false);
+	// Section of the atlas holding path, images left out of it are loaded
+	// as a whole texture that is freed in CleanUp
+	AtlasRegion GetRegion(const char* path);
+
+	// Hot reload. The texture keeps its id when the image size did not change,
+	// otherwise it is created again and holders of the old one must refresh it
+	bool ReloadTexture(Texture2D& texture, const char* path);
+	// False when the sprite changed size, reload the atlas and its regions then
+	bool ReloadAtlasSprite(const char* path);
 	bool Draw(Texture2D texture, int x, int y, const Rectangle* section = NULL, double angle = 0, int pivot_x = 0, int pivot_y = 0) const;
     bool DrawText(const char* text, int x, int y, Font font, int spacing, Color tint) const;
 
+	// Sprites are queued and drawn on FlushSprites(), lower layers first and
+	// grouped by texture inside a layer. Anything left is flushed in PostUpdate
+	bool DrawSprite(Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin, float rotation, int layer, Color tint = WHITE);
+	void FlushSprites();
+
+private:
+
+	void DrawProfiler() const;
+
 public:
 
 	Color background;
     Rectangle camera;
+
+	// F3 toggles the frame profiler overlay, F4 dumps it to PROFILER_CSV_PATH
+	bool show_profiler;
+
+private:
+
+	std::vector<Sprite> sprites;
+
+	TextureAtlas atlas;
+	std::vector<Texture2D> loose_textures;
+
+	// Last frame totals, shown in the profiler overlay
+	uint frame_sprites;
+	uint frame_sprite_groups;
+	uint sprite_count;
+	uint sprite_groups;
 };
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "Profiler.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 26495)
+#endif
+#include "box2d\box2d.h"
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+Profiler::Profiler()
+{
+	head = 0;
+	count = 0;
+	module_count = 0;
+	stat_count = 0;
+}
+
+int Profiler::AddModule(const char* name)
+{
+	if (module_count >= PROFILER_MAX_MODULES)
+		return -1;
+
+	module_names[module_count] = name;
+	return module_count++;
+}
+
+void Profiler::BeginFrame(uint64 frame)
+{
+	current = FrameProfile();
+	current.frame = frame;
+	frame_timer.Start();
+}
+
+void Profiler::AddModuleTime(int module, ProfilePhase phase, uint64 ticks)
+{
+	if (module >= 0 && module < module_count)
+		current.module_ms[module][phase] += Timer::TicksToMs(ticks);
+}
+
+void Profiler::SetPhysicsProfile(const b2Profile& profile, int steps)
+{
+	current.physics_steps = steps;
+	current.step_ms = profile.step;
+	current.collide_ms = profile.collide;
+	current.solve_ms = profile.solve;
+	current.solve_toi_ms = profile.solveTOI;
+	current.broadphase_ms = profile.broadphase;
+}
+
+void Profiler::EndFrame()
+{
+	current.frame_ms = frame_timer.ReadMs();
+
+	frames[head] = current;
+	head = (head + 1) % PROFILER_FRAMES;
+	if (count < PROFILER_FRAMES) count++;
+}
+
+const FrameProfile& Profiler::GetLastFrame() const
+{
+	return frames[(head + PROFILER_FRAMES - 1) % PROFILER_FRAMES];
+}
+
+uint Profiler::GetFrameCount() const
+{
+	return count;
+}
+
+int Profiler::GetModuleCount() const
+{
+	return module_count;
+}
+
+const char* Profiler::GetModuleName(int module) const
+{
+	return (module >= 0 && module < module_count) ? module_names[module] : "";
+}
+
+// One row per frame, oldest first
+bool Profiler::DumpCSV(const char* path) const
+{
+	FILE* file = NULL;
+
+	if (fopen_s(&file, path, "w") != 0 || file == NULL)
+	{
+		LOG("Cannot open profiler dump: %s", path);
+		return false;
+	}
+
+	static const char* phase_names[PROFILE_PHASE_COUNT] = { "pre", "update", "post" };
+
+	fprintf(file, "frame,frame_ms");
+	for (int m = 0; m < module_count; ++m)
+	{
+		for (int p = 0; p < PROFILE_PHASE_COUNT; ++p)
+			fprintf(file, ",%s_%s_ms", module_names[m], phase_names[p]);
+	}
+	fprintf(file, ",physics_steps,step_ms,collide_ms,solve_ms,solve_toi_ms,broadphase_ms\n");
+
+	uint first = (head + PROFILER_FRAMES - count) % PROFILER_FRAMES;
+
+	for (uint i = 0; i < count; ++i)
+	{
+		const FrameProfile& f = frames[(first + i) % PROFILER_FRAMES];
+
+		fprintf(file, "%llu,%.4f", (unsigned long long)f.frame, f.frame_ms);
+		for (int m = 0; m < module_count; ++m)
+		{
+			for (int p = 0; p < PROFILE_PHASE_COUNT; ++p)
+				fprintf(file, ",%.4f", f.module_ms[m][p]);
+		}
+		fprintf(file, ",%d,%.4f,%.4f,%.4f,%.4f,%.4f\n", f.physics_steps, f.step_ms, f.collide_ms, f.solve_ms, f.solve_toi_ms, f.broadphase_ms);
+	}
+
+	fclose(file);
+
+	LOG("Profiler dumped %u frames to %s", count, path);
+
+	return true;
+}
+
+void Profiler::AddStat(const TimeStat* stat)
+{
+	if (stat_count < PROFILER_MAX_STATS)
+		stats[stat_count++] = stat;
+}
+
+int Profiler::GetStatCount() const
+{
+	return stat_count;
+}
+
+const TimeStat* Profiler::GetStat(int index) const
+{
+	return (index >= 0 && index < stat_count) ? stats[index] : nullptr;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Globals.h"
+#include "Timer.h"
+
+#define PROFILER_FRAMES			600
+#define PROFILER_MAX_MODULES	8
+#define PROFILER_MAX_STATS		16
+#define PROFILER_CSV_PATH		"profile.csv"
+
+struct b2Profile;
+
+enum ProfilePhase
+{
+	PROFILE_PRE_UPDATE = 0,
+	PROFILE_UPDATE,
+	PROFILE_POST_UPDATE,
+	PROFILE_PHASE_COUNT
+};
+
+// Timings of one frame, all values in milliseconds
+struct FrameProfile
+{
+	uint64 frame = 0;
+	double frame_ms = 0.0;
+	double module_ms[PROFILER_MAX_MODULES][PROFILE_PHASE_COUNT] = {};
+
+	// b2World::GetProfile() summed over the physics steps of the frame
+	int physics_steps = 0;
+	float step_ms = 0.0f;
+	float collide_ms = 0.0f;
+	float solve_ms = 0.0f;
+	float solve_toi_ms = 0.0f;
+	float broadphase_ms = 0.0f;
+};
+
+// Keeps the last PROFILER_FRAMES frame timings in a fixed ring buffer
+class Profiler
+{
+public:
+
+	Profiler();
+
+	// Returns the column index of the module, or -1 when full
+	int AddModule(const char* name);
+
+	void BeginFrame(uint64 frame);
+	void AddModuleTime(int module, ProfilePhase phase, uint64 ticks);
+	void SetPhysicsProfile(const b2Profile& profile, int steps);
+	void EndFrame();
+
+	// Last completed frame
+	const FrameProfile& GetLastFrame() const;
+	uint GetFrameCount() const;
+
+	int GetModuleCount() const;
+	const char* GetModuleName(int module) const;
+
+	bool DumpCSV(const char* path) const;
+
+	// Scoped timing statistics shown in the overlay, owned by the caller
+	void AddStat(const TimeStat* stat);
+	int GetStatCount() const;
+	const TimeStat* GetStat(int index) const;
+
+private:
+
+	FrameProfile frames[PROFILER_FRAMES];
+	uint head;
+	uint count;
+
+	FrameProfile current;
+	Timer frame_timer;
+
+	const char* module_names[PROFILER_MAX_MODULES];
+	int module_count;
+
+	const TimeStat* stats[PROFILER_MAX_STATS];
+	int stat_count;
+};
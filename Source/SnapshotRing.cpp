@@ -0,0 +1,56 @@
+#include "SnapshotRing.h"
+
+SnapshotRing::SnapshotRing() : head(0), count(0)
+{
+}
+
+void SnapshotRing::Init(uint capacity)
+{
+	slots.assign(capacity, WorldSnapshot{});
+	Clear();
+}
+
+void SnapshotRing::Clear()
+{
+	head = 0;
+	count = 0;
+}
+
+WorldSnapshot& SnapshotRing::Push()
+{
+	WorldSnapshot& slot = slots[head];
+
+	head = (head + 1) % (uint)slots.size();
+	if (count < slots.size())
+		count++;
+
+	return slot;
+}
+
+void SnapshotRing::Pop()
+{
+	if (count == 0)
+		return;
+
+	head = (head == 0) ? (uint)slots.size() - 1 : head - 1;
+	count--;
+}
+
+const WorldSnapshot* SnapshotRing::Get(uint back) const
+{
+	if (back >= count)
+		return NULL;
+
+	uint size = (uint)slots.size();
+	return &slots[(head + size - 1 - back) % size];
+}
+
+uint SnapshotRing::GetCount() const
+{
+	return count;
+}
+
+uint SnapshotRing::GetCapacity() const
+{
+	return (uint)slots.size();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <vector>
+
+#define SNAPSHOT_USER_SIZE	32
+
+// Dynamic or kinematic body, matched by PhysBody::serial when restoring.
+// Positions in meters, angles in radians
+struct BodySnapshot
+{
+	uint serial;
+	float x, y, angle;
+	float vx, vy, angular_velocity;
+	float sleep_time;
+	bool awake;
+};
+
+// Revolute joint, matched by the serials of its two bodies since a hot reload
+// recreates the flippers and reorders the joint list. The impulses are what
+// the solver warm starts from, without them a restored flipper drifts
+struct JointSnapshot
+{
+	uint serial_a, serial_b;
+	float motor_speed;
+	bool motor_enabled;
+	float impulse_x, impulse_y;
+	float motor_impulse, lower_impulse, upper_impulse;
+};
+
+// Warm starting impulses of a touching contact, found again by its bodies,
+// chain children and manifold point ids
+struct ContactSnapshot
+{
+	uint serial_a, serial_b;
+	int child_a, child_b;
+	int point_count;
+	uint32 ids[2];
+	float normal_impulses[2];
+	float tangent_impulses[2];
+};
+
+// Moving state of the world after a physics step, as many bodies and contacts
+// as the world has. user is filled by the snapshot listener with its own state
+struct WorldSnapshot
+{
+	uint step;
+	std::vector<BodySnapshot> bodies;
+	std::vector<JointSnapshot> joints;
+	std::vector<ContactSnapshot> contacts;
+	uchar user[SNAPSHOT_USER_SIZE];
+};
+
+// The last snapshots taken, oldest ones overwritten once full. Every slot is
+// created by Init and its vectors keep their capacity when reused, so pushing
+// only allocates while the world grows past what a slot has held before
+class SnapshotRing
+{
+public:
+
+	SnapshotRing();
+
+	void Init(uint capacity);
+	void Clear();
+
+	// Slot for the new snapshot, fill it before the next Push
+	WorldSnapshot& Push();
+	// Drops the newest snapshot
+	void Pop();
+
+	// back = 0 is the newest, NULL past the oldest one kept
+	const WorldSnapshot* Get(uint back) const;
+	uint GetCount() const;
+	uint GetCapacity() const;
+
+private:
+
+	std::vector<WorldSnapshot> slots;
+	uint head;	// next slot to write
+	uint count;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <atomic>
+
+// Fixed size ring for one producer thread and one consumer thread, without
+// locks. Holds SIZE - 1 items, T is copied so keep it plain data
+template<class T, uint SIZE>
+class SpscQueue
+{
+public:
+
+	SpscQueue() : head(0), tail(0)
+	{
+	}
+
+	// Producer only, false when full
+	bool Push(const T& item)
+	{
+		uint h = head.load(std::memory_order_relaxed);
+		uint next = (h + 1) % SIZE;
+
+		if (next == tail.load(std::memory_order_acquire))
+			return false;
+
+		items[h] = item;
+		head.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only, false when empty
+	bool Pop(T& item)
+	{
+		uint t = tail.load(std::memory_order_relaxed);
+
+		if (t == head.load(std::memory_order_acquire))
+			return false;
+
+		item = items[t];
+		tail.store((t + 1) % SIZE, std::memory_order_release);
+		return true;
+	}
+
+private:
+
+	T items[SIZE];
+
+	// Each index on its own cache line, every side writes only one of them
+	char pad0[64];
+	std::atomic<uint> head;
+	char pad1[64];
+	std::atomic<uint> tail;
+	char pad2[64];
+};
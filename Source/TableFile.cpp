@@ -0,0 +1,330 @@
+#include "TableFile.h"
+#include "ModulePhysics.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+
+// Copies the next word of cursor into word, cursor is left after it
+static bool ParseWord(const char*& cursor, char* word, int size)
+{
+	while (*cursor == ' ' || *cursor == '\t') ++cursor;
+
+	int length = 0;
+	while ((isalnum((unsigned char)*cursor) || *cursor == '_') && length < size - 1)
+		word[length++] = *cursor++;
+
+	word[length] = '\0';
+	return length > 0;
+}
+
+static bool ParseInts(const char*& cursor, int* values, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		char* end = NULL;
+		values[i] = (int)strtol(cursor, &end, 10);
+		if (end == cursor)
+			return false;
+		cursor = end;
+	}
+
+	return true;
+}
+
+static bool ParseFloats(const char*& cursor, float* values, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		char* end = NULL;
+		values[i] = strtof(cursor, &end);
+		if (end == cursor)
+			return false;
+		cursor = end;
+	}
+
+	return true;
+}
+
+static int FindName(const char* word, const char* const* names, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (strcmp(word, names[i]) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+static const char* const SENSOR_NAMES[TABLE_SENSOR_COUNT] = { "goal", "own_goal", "drain" };
+static const char* const FLIPPER_NAMES[TABLE_FLIPPER_COUNT] = { "left", "right" };
+
+TableFile::TableFile()
+{
+	header = NULL;
+	sensors = NULL;
+	chains = NULL;
+	vertices = NULL;
+}
+
+bool TableFile::Load(const char* source, const char* compiled, bool force)
+{
+	Unload();
+
+	bool stale = force || FileExists(compiled) == false ||
+		(FileExists(source) && GetFileModTime(source) > GetFileModTime(compiled));
+
+	if (stale == false && Map(compiled))
+		return true;
+
+	// Forced, missing, older than its source or from another version
+	return Compile(source, compiled) && Map(compiled);
+}
+
+void TableFile::Unload()
+{
+	file.Close();
+
+	header = NULL;
+	sensors = NULL;
+	chains = NULL;
+	vertices = NULL;
+}
+
+const TableHeader& TableFile::GetHeader() const
+{
+	return *header;
+}
+
+const TableSensor* TableFile::GetSensors() const
+{
+	return sensors;
+}
+
+const TableChain* TableFile::GetChains() const
+{
+	return chains;
+}
+
+const b2Vec2* TableFile::GetVertices(const TableChain& chain) const
+{
+	return vertices + chain.first;
+}
+
+bool TableFile::Map(const char* compiled)
+{
+	if (file.Open(compiled) == false)
+		return false;
+
+	const uchar* data = (const uchar*)file.GetData();
+	size_t size = file.GetSize();
+	const TableHeader* h = (const TableHeader*)data;
+
+	bool ret = size >= sizeof(TableHeader) && h->magic == TABLE_MAGIC && h->version == TABLE_VERSION;
+
+	if (ret)
+	{
+		size_t expected = sizeof(TableHeader) +
+			h->sensor_count * sizeof(TableSensor) +
+			h->chain_count * sizeof(TableChain) +
+			h->vertex_count * sizeof(b2Vec2);
+
+		ret = size == expected;
+	}
+
+	if (ret == false)
+	{
+		LOG("Invalid compiled table %s", compiled);
+		Unload();
+		return false;
+	}
+
+	header = h;
+	sensors = (const TableSensor*)(data + sizeof(TableHeader));
+	chains = (const TableChain*)(sensors + h->sensor_count);
+	vertices = (const b2Vec2*)(chains + h->chain_count);
+
+	for (uint i = 0; i < h->chain_count; ++i)
+	{
+		if (chains[i].count < 3 || chains[i].first + chains[i].count > h->vertex_count)
+		{
+			LOG("Invalid chain %u in compiled table %s", i, compiled);
+			Unload();
+			return false;
+		}
+	}
+
+	LOG("Loaded table %s: %u sensors, %u chains, %u vertices", compiled, h->sensor_count, h->chain_count, h->vertex_count);
+	return true;
+}
+
+// Text format, one entry per line, positions in pixels and angles in degrees:
+//   goalkeeper <x> <y> <width> <height> <min x> <max x>
+//   flipper <left|right> <pivot x> <pivot y> <x> <y> <lower angle> <upper angle>
+//   sensor <goal|own_goal|drain> <x> <y> <width> <height>
+//   chain, then one "<x> <y>" vertex per line until end
+// Vertices are stored in meters, recompile the tables if METER_PER_PIXEL changes
+bool TableFile::Compile(const char* source, const char* compiled)
+{
+	FILE* input = NULL;
+	if (fopen_s(&input, source, "r") != 0 || input == NULL)
+	{
+		LOG("Cannot open table %s", source);
+		return false;
+	}
+
+	TableHeader h;
+	memset(&h, 0, sizeof(h));
+	h.magic = TABLE_MAGIC;
+	h.version = TABLE_VERSION;
+
+	std::vector<TableSensor> table_sensors;
+	std::vector<TableChain> table_chains;
+	std::vector<b2Vec2> table_vertices;
+
+	bool ret = true;
+	bool in_chain = false;
+	bool has_goalkeeper = false;
+	bool has_flipper[TABLE_FLIPPER_COUNT] = {};
+	bool has_drain = false;
+	char line[256];
+	int line_number = 0;
+
+	while (ret && fgets(line, sizeof(line), input) != NULL)
+	{
+		line_number++;
+
+		const char* cursor = line;
+		while (*cursor == ' ' || *cursor == '\t') ++cursor;
+
+		if (*cursor == '#' || *cursor == '\r' || *cursor == '\n' || *cursor == '\0')
+			continue;
+
+		if (in_chain)
+		{
+			char word[32];
+			const char* start = cursor;
+
+			if (ParseWord(start, word, sizeof(word)) && strcmp(word, "end") == 0)
+			{
+				TableChain& chain = table_chains.back();
+				chain.count = (uint32)table_vertices.size() - chain.first;
+				ret = chain.count >= 3;
+				in_chain = false;
+			}
+			else
+			{
+				int v[2];
+				ret = ParseInts(cursor, v, 2);
+				if (ret) table_vertices.push_back(b2Vec2(PIXEL_TO_METERS(v[0]), PIXEL_TO_METERS(v[1])));
+			}
+
+			continue;
+		}
+
+		char word[32];
+		ret = ParseWord(cursor, word, sizeof(word));
+
+		if (ret && strcmp(word, "goalkeeper") == 0)
+		{
+			int v[6];
+			ret = ParseInts(cursor, v, 6);
+			h.goalkeeper = TableGoalkeeper{ TableRect{ v[0], v[1], v[2], v[3] }, v[4], v[5] };
+			has_goalkeeper = ret;
+		}
+		else if (ret && strcmp(word, "flipper") == 0)
+		{
+			char side[32];
+			int v[4];
+			float angles[2];
+			int i = ParseWord(cursor, side, sizeof(side)) ? FindName(side, FLIPPER_NAMES, TABLE_FLIPPER_COUNT) : -1;
+
+			ret = i >= 0 && ParseInts(cursor, v, 4) && ParseFloats(cursor, angles, 2);
+			if (ret)
+			{
+				h.flippers[i] = TableFlipper{ v[0], v[1], v[2], v[3], angles[0] * DEGTORAD, angles[1] * DEGTORAD };
+				has_flipper[i] = true;
+			}
+		}
+		else if (ret && strcmp(word, "sensor") == 0)
+		{
+			char type[32];
+			int v[4];
+			int i = ParseWord(cursor, type, sizeof(type)) ? FindName(type, SENSOR_NAMES, TABLE_SENSOR_COUNT) : -1;
+
+			ret = i >= 0 && ParseInts(cursor, v, 4);
+			if (ret)
+			{
+				table_sensors.push_back(TableSensor{ (uint32)i, TableRect{ v[0], v[1], v[2], v[3] } });
+				has_drain = has_drain || i == TABLE_SENSOR_DRAIN;
+			}
+		}
+		else if (ret && strcmp(word, "chain") == 0)
+		{
+			table_chains.push_back(TableChain{ (uint32)table_vertices.size(), 0 });
+			in_chain = true;
+		}
+		else
+		{
+			ret = false;
+		}
+	}
+
+	fclose(input);
+
+	if (ret && in_chain)
+	{
+		LOG("%s: chain without end", source);
+		return false;
+	}
+
+	if (ret == false)
+	{
+		LOG("%s(%d): invalid table entry", source, line_number);
+		return false;
+	}
+
+	// Sin estas piezas la mesa se construiría con ceros
+	if (has_goalkeeper == false)
+	{
+		LOG("%s: missing goalkeeper", source);
+		return false;
+	}
+
+	for (int i = 0; i < TABLE_FLIPPER_COUNT; ++i)
+	{
+		if (has_flipper[i] == false)
+		{
+			LOG("%s: missing %s flipper", source, FLIPPER_NAMES[i]);
+			return false;
+		}
+	}
+
+	if (has_drain == false)
+	{
+		LOG("%s: missing drain sensor", source);
+		return false;
+	}
+
+	h.sensor_count = (uint32)table_sensors.size();
+	h.chain_count = (uint32)table_chains.size();
+	h.vertex_count = (uint32)table_vertices.size();
+
+	FILE* output = NULL;
+	if (fopen_s(&output, compiled, "wb") != 0 || output == NULL)
+	{
+		LOG("Cannot write compiled table %s", compiled);
+		return false;
+	}
+
+	fwrite(&h, sizeof(h), 1, output);
+	if (h.sensor_count > 0) fwrite(table_sensors.data(), sizeof(TableSensor), h.sensor_count, output);
+	if (h.chain_count > 0) fwrite(table_chains.data(), sizeof(TableChain), h.chain_count, output);
+	if (h.vertex_count > 0) fwrite(table_vertices.data(), sizeof(b2Vec2), h.vertex_count, output);
+	fclose(output);
+
+	LOG("Compiled table %s into %s", source, compiled);
+	return true;
+}
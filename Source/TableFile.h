@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Globals.h"
+#include "MappedFile.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// Suppress: Variable is uninitialized (C26495) for third-party Box2D types
+#pragma warning(disable : 26495)
+#endif
+#include "box2d\box2d.h"
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#define TABLE_MAGIC		0x314C4254	// "TBL1"
+#define TABLE_VERSION	1
+
+enum TableSensorType
+{
+	TABLE_SENSOR_GOAL,
+	TABLE_SENSOR_OWN_GOAL,
+	TABLE_SENSOR_DRAIN,
+	TABLE_SENSOR_COUNT
+};
+
+enum TableFlipperSide
+{
+	TABLE_FLIPPER_LEFT,
+	TABLE_FLIPPER_RIGHT,
+	TABLE_FLIPPER_COUNT
+};
+
+// Compiled table layout. Every field is 4 bytes so the file is used in place
+// once mapped: a TableHeader followed by sensor_count TableSensor,
+// chain_count TableChain and vertex_count b2Vec2 (in meters)
+struct TableRect
+{
+	int x, y;	// center, in pixels
+	int width, height;
+};
+
+struct TableGoalkeeper
+{
+	TableRect rect;
+	int min_x, max_x;	// it moves between these
+};
+
+struct TableSensor
+{
+	uint32 type;
+	TableRect rect;
+};
+
+struct TableFlipper
+{
+	int pivot_x, pivot_y;
+	int x, y;
+	float lower_angle, upper_angle;	// radians
+};
+
+struct TableChain
+{
+	uint32 first;	// index of its first vertex
+	uint32 count;
+};
+
+struct TableHeader
+{
+	uint32 magic;
+	uint32 version;
+	TableGoalkeeper goalkeeper;
+	TableFlipper flippers[TABLE_FLIPPER_COUNT];
+	uint32 sensor_count;
+	uint32 chain_count;
+	uint32 vertex_count;
+};
+
+// Table geometry described in a text file (see Assets/table.txt) and compiled
+// to a binary file next to it. The binary is rebuilt when it is missing or
+// older than the text, then mapped and read without any parsing
+class TableFile
+{
+public:
+
+	TableFile();
+
+	// force compiles the source even when the binary looks up to date
+	bool Load(const char* source, const char* compiled, bool force = false);
+	void Unload();
+
+	const TableHeader& GetHeader() const;
+	const TableSensor* GetSensors() const;
+	const TableChain* GetChains() const;
+	const b2Vec2* GetVertices(const TableChain& chain) const;
+
+private:
+
+	bool Compile(const char* source, const char* compiled);
+	bool Map(const char* compiled);
+
+private:
+
+	MappedFile file;
+	const TableHeader* header;
+	const TableSensor* sensors;
+	const TableChain* chains;
+	const b2Vec2* vertices;
+};
@@ -0,0 +1,296 @@
+#include "TextureAtlas.h"
+#include "AssetLoader.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+// Reads count integers separated by spaces, cursor is left after the last one
+static bool ParseInts(const char*& cursor, int* values, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		char* end = NULL;
+		values[i] = (int)strtol(cursor, &end, 10);
+		if (end == cursor)
+			return false;
+		cursor = end;
+	}
+
+	return true;
+}
+
+TextureAtlas::TextureAtlas()
+{
+	texture = Texture2D{};
+	width = height = 0;
+	loads = 0;
+}
+
+bool TextureAtlas::Load(const char* const* paths, int count, const char* cache, bool headless, AssetLoader* loader, std::function<void()> on_upload, bool rebuild)
+{
+	Unload();
+	uint load = ++loads;
+
+	if (rebuild == false && LoadCache(paths, count, cache))
+	{
+		LOG("Loaded texture atlas %s.png: %d sprites in %dx%d", cache, count, width, height);
+
+		std::string png_path = std::string(cache) + ".png";
+
+		if (headless == false && loader != nullptr)
+		{
+			loader->LoadImageAsync(png_path.c_str(), [this, load, on_upload](const Image& image)
+			{
+				if (image.data == NULL || load != loads)
+					return;
+
+				texture = LoadTextureFromImage(image);
+				if (on_upload) on_upload();
+			});
+		}
+		else if (headless == false)
+		{
+			texture = ::LoadTexture(png_path.c_str());
+		}
+
+		return true;
+	}
+
+	return Build(paths, count, cache, headless);
+}
+
+void TextureAtlas::Unload()
+{
+	if (texture.id != 0)
+		UnloadTexture(texture);
+
+	texture = Texture2D{};
+	entries.clear();
+}
+
+bool TextureAtlas::Find(const char* path, AtlasRegion& region) const
+{
+	for (const Entry& entry : entries)
+	{
+		if (entry.path == path)
+		{
+			region.texture = texture;
+			region.section = entry.rect;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool TextureAtlas::UpdateSprite(const char* path, bool headless)
+{
+	for (const Entry& entry : entries)
+	{
+		if (entry.path != path)
+			continue;
+
+		Image image = LoadImage(path);
+		bool ret = image.data != NULL && image.width == (int)entry.rect.width && image.height == (int)entry.rect.height;
+
+		// Only the pixels of this sprite are sent, the atlas was built as RGBA8
+		if (ret && headless == false)
+		{
+			ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+			UpdateTextureRec(texture, entry.rect, image.data);
+		}
+
+		UnloadImage(image);
+		return ret;
+	}
+
+	return false;
+}
+
+Texture2D TextureAtlas::GetTexture() const
+{
+	return texture;
+}
+
+// The cache is valid if it lists the same images and none of them changed since
+bool TextureAtlas::LoadCache(const char* const* paths, int count, const char* cache)
+{
+	std::string png_path = std::string(cache) + ".png";
+	std::string txt_path = std::string(cache) + ".txt";
+
+	if (FileExists(png_path.c_str()) == false)
+		return false;
+
+	long built_at = GetFileModTime(png_path.c_str());
+	for (int i = 0; i < count; ++i)
+	{
+		if (GetFileModTime(paths[i]) > built_at)
+			return false;
+	}
+
+	FILE* file = NULL;
+	if (fopen_s(&file, txt_path.c_str(), "r") != 0 || file == NULL)
+		return false;
+
+	char line[512];
+	const char* cursor = line + 5;
+	int header[3] = { 0, 0, 0 };
+	bool ret = fgets(line, sizeof(line), file) != NULL &&
+		strncmp(line, "atlas", 5) == 0 &&
+		ParseInts(cursor, header, 3) &&
+		header[2] == count;
+
+	width = header[0];
+	height = header[1];
+
+	for (int i = 0; i < count && ret; ++i)
+	{
+		int rect[4];
+		cursor = line;
+		ret = fgets(line, sizeof(line), file) != NULL && ParseInts(cursor, rect, 4);
+
+		if (ret)
+		{
+			// The rest of the line is the path
+			while (*cursor == ' ') ++cursor;
+			std::string path(cursor, strcspn(cursor, "\r\n"));
+
+			ret = path == paths[i];
+
+			Entry entry;
+			entry.path = path;
+			entry.rect = Rectangle{ (float)rect[0], (float)rect[1], (float)rect[2], (float)rect[3] };
+			entries.push_back(entry);
+		}
+	}
+
+	fclose(file);
+
+	if (ret == false)
+		entries.clear();
+
+	return ret;
+}
+
+bool TextureAtlas::Build(const char* const* paths, int count, const char* cache, bool headless)
+{
+	std::vector<Image> images;
+	bool ret = true;
+
+	for (int i = 0; i < count && ret; ++i)
+	{
+		Image image = LoadImage(paths[i]);
+
+		if (image.data == NULL)
+		{
+			LOG("Cannot load atlas sprite: %s", paths[i]);
+			ret = false;
+			break;
+		}
+
+		Entry entry;
+		entry.path = paths[i];
+		entry.rect = Rectangle{ 0.0f, 0.0f, (float)image.width, (float)image.height };
+		entries.push_back(entry);
+		images.push_back(image);
+	}
+
+	// Smallest power of two size the sprites fit in
+	int w = 256, h = 256;
+	while (ret && Pack(w, h) == false)
+	{
+		if (w <= h) w *= 2;
+		else h *= 2;
+
+		if (w > ATLAS_MAX_SIZE)
+		{
+			LOG("Texture atlas sprites do not fit in %dx%d", ATLAS_MAX_SIZE, ATLAS_MAX_SIZE);
+			ret = false;
+		}
+	}
+
+	if (ret)
+	{
+		Image atlas = GenImageColor(width, height, BLANK);
+
+		for (uint i = 0; i < images.size(); ++i)
+		{
+			Rectangle source = { 0.0f, 0.0f, (float)images[i].width, (float)images[i].height };
+			ImageDraw(&atlas, images[i], source, entries[i].rect, WHITE);
+		}
+
+		std::string png_path = std::string(cache) + ".png";
+		std::string txt_path = std::string(cache) + ".txt";
+		FILE* file = NULL;
+
+		if (ExportImage(atlas, png_path.c_str()) && fopen_s(&file, txt_path.c_str(), "w") == 0 && file != NULL)
+		{
+			fprintf(file, "atlas %d %d %d\n", width, height, (int)entries.size());
+			for (const Entry& entry : entries)
+				fprintf(file, "%d %d %d %d %s\n", (int)entry.rect.x, (int)entry.rect.y, (int)entry.rect.width, (int)entry.rect.height, entry.path.c_str());
+			fclose(file);
+		}
+		else
+		{
+			LOG("Cannot write texture atlas cache %s", cache);
+		}
+
+		if (headless == false)
+			texture = LoadTextureFromImage(atlas);
+
+		UnloadImage(atlas);
+
+		LOG("Built texture atlas %s.png: %d sprites in %dx%d", cache, count, width, height);
+	}
+	else
+	{
+		entries.clear();
+	}
+
+	for (Image& image : images)
+		UnloadImage(image);
+
+	return ret;
+}
+
+// Shelf packing, tallest sprites first. Fails if they do not fit in w x h
+bool TextureAtlas::Pack(int w, int h)
+{
+	std::vector<uint> order(entries.size());
+	for (uint i = 0; i < order.size(); ++i)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [this](uint a, uint b)
+	{
+		return entries[a].rect.height > entries[b].rect.height;
+	});
+
+	int x = 0, y = 0, shelf = 0;
+
+	for (uint i : order)
+	{
+		Rectangle& rect = entries[i].rect;
+
+		if (x + (int)rect.width > w)
+		{
+			x = 0;
+			y += shelf + ATLAS_PADDING;
+			shelf = 0;
+		}
+
+		if (x + (int)rect.width > w || y + (int)rect.height > h)
+			return false;
+
+		rect.x = (float)x;
+		rect.y = (float)y;
+
+		x += (int)rect.width + ATLAS_PADDING;
+		if ((int)rect.height > shelf) shelf = (int)rect.height;
+	}
+
+	width = w;
+	height = h;
+
+	return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#define ATLAS_PADDING		2
+#define ATLAS_MAX_SIZE		4096
+#define ATLAS_CACHE_PATH	"Assets/atlas"
+
+// Where a sprite lives: the texture to bind and the section to sample
+class AssetLoader;
+
+struct AtlasRegion
+{
+	Texture2D texture{};
+	Rectangle section{};
+};
+
+// Packs several images into one texture so they can be drawn without
+// switching textures. The packed image and its rectangles are cached in
+// <cache>.png and <cache>.txt and rebuilt only when a source is newer
+class TextureAtlas
+{
+public:
+
+	TextureAtlas();
+
+	// Without a GL context (headless) only the rectangles are computed. With a
+	// loader a valid cache is decoded in the background: the rectangles are
+	// ready on return and on_upload runs once the texture is created. rebuild
+	// packs the sources again even if the cache looks up to date
+	bool Load(const char* const* paths, int count, const char* cache, bool headless, AssetLoader* loader = nullptr, std::function<void()> on_upload = nullptr, bool rebuild = false);
+	void Unload();
+
+	bool Find(const char* path, AtlasRegion& region) const;
+
+	// Uploads path again into its region. False if it is not in the atlas or
+	// its size changed, then the atlas has to be loaded again
+	bool UpdateSprite(const char* path, bool headless);
+	Texture2D GetTexture() const;
+
+private:
+
+	struct Entry
+	{
+		std::string path;
+		Rectangle rect;
+	};
+
+	bool LoadCache(const char* const* paths, int count, const char* cache);
+	bool Build(const char* const* paths, int count, const char* cache, bool headless);
+	bool Pack(int width, int height);
+
+private:
+
+	Texture2D texture;
+	int width, height;
+	uint loads;	// an upload from an older Load is ignored
+	std::vector<Entry> entries;
+};
@@ -1,11 +1,11 @@
 // ----------------------------------------------------
 // j1Timer.cpp
-// Fast timer with milisecons precision
+// Fast timer with nanosecond ticks on the steady clock
 // ----------------------------------------------------
 
 #include "Timer.h"
 
-#include "raylib.h"
+#include <chrono>
 
 Timer::Timer()
 {
@@ -14,10 +14,88 @@ Timer::Timer()
 
 void Timer::Start()
 {
-	started_at = GetTime();
+	started_at = GetTicks();
+}
+
+uint64_t Timer::ReadTicks() const
+{
+	return GetTicks() - started_at;
+}
+
+double Timer::ReadUs() const
+{
+	return (double)ReadTicks() / 1000.0;
+}
+
+double Timer::ReadMs() const
+{
+	return (double)ReadTicks() / 1000000.0;
 }
 
 double Timer::ReadSec() const
 {
-	return (GetTime() - started_at);
-}
\ No newline at end of file
+	return (double)ReadTicks() / 1000000000.0;
+}
+
+uint64_t Timer::GetTicks()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double Timer::TicksToMs(uint64_t ticks)
+{
+	return (double)ticks / 1000000.0;
+}
+
+// ----------------------------------------------------
+TimeStat::TimeStat(const char* name) : name(name)
+{
+	Reset();
+}
+
+void TimeStat::Add(uint64_t ticks)
+{
+	if (count == 0 || ticks < min) min = ticks;
+	if (ticks > max) max = ticks;
+
+	total += ticks;
+	count++;
+}
+
+void TimeStat::Reset()
+{
+	count = 0;
+	total = 0;
+	min = 0;
+	max = 0;
+}
+
+const char* TimeStat::GetName() const
+{
+	return name;
+}
+
+uint64_t TimeStat::GetCount() const
+{
+	return count;
+}
+
+double TimeStat::GetMinMs() const
+{
+	return Timer::TicksToMs(min);
+}
+
+double TimeStat::GetMaxMs() const
+{
+	return Timer::TicksToMs(max);
+}
+
+double TimeStat::GetMeanMs() const
+{
+	return (count > 0) ? Timer::TicksToMs(total) / (double)count : 0.0;
+}
+
+double TimeStat::GetTotalMs() const
+{
+	return Timer::TicksToMs(total);
+}
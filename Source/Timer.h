@@ -1,8 +1,15 @@
 #pragma once
 
-#include "Globals.h"
-#include "Timer.h"
+// No Globals.h here: this header is also meant to be included from Box2D sources
+#include <stdint.h>
 
+#define TIMER_CONCAT_IMPL(a, b) a##b
+#define TIMER_CONCAT(a, b) TIMER_CONCAT_IMPL(a, b)
+
+// Times the rest of the enclosing scope into a TimeStat
+#define SCOPED_TIMER(stat) ScopedTimer TIMER_CONCAT(scoped_timer_, __LINE__)(stat)
+
+// Steady clock timer with nanosecond ticks, usable before InitWindow()
 class Timer
 {
 public:
@@ -11,10 +18,62 @@ public:
 	Timer();
 
 	void Start();
+	uint64_t ReadTicks() const;
+	double ReadUs() const;
+	double ReadMs() const;
 	double ReadSec() const;
 
+	// Nanoseconds since an arbitrary fixed point
+	static uint64_t GetTicks();
+	static double TicksToMs(uint64_t ticks);
+
+private:
+
+    // Start time in ticks
+	uint64_t started_at;
+};
+
+// Count, min, max and mean of a set of timings
+class TimeStat
+{
+public:
+
+	TimeStat(const char* name);
+
+	void Add(uint64_t ticks);
+	void Reset();
+
+	const char* GetName() const;
+	uint64_t GetCount() const;
+	double GetMinMs() const;
+	double GetMaxMs() const;
+	double GetMeanMs() const;
+	double GetTotalMs() const;
+
+private:
+
+	const char* name;
+	uint64_t count;
+	uint64_t total;
+	uint64_t min;
+	uint64_t max;
+};
+
+// Adds the time between its construction and destruction to a TimeStat
+class ScopedTimer
+{
+public:
+
+	ScopedTimer(TimeStat& stat) : stat(stat), started_at(Timer::GetTicks())
+	{}
+
+	~ScopedTimer()
+	{
+		stat.Add(Timer::GetTicks() - started_at);
+	}
+
 private:
 
-    // Start time in seconds
-	double started_at;   
-};
\ No newline at end of file
+	TimeStat& stat;
+	uint64_t started_at;
+};
@@ -0,0 +1,147 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool() : ranges(nullptr), worker_count(1), job(0), busy(0), running(false), task(nullptr), context(nullptr), stolen(0)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+	Stop();
+}
+
+void WorkerPool::Start(uint count)
+{
+	if (running)
+		return;
+
+	if (count == 0)
+		count = std::thread::hardware_concurrency();
+
+	count = MIN(MAX(count, 1u), (uint)WORKER_POOL_MAX_THREADS);
+
+	worker_count = (int32)count;
+	ranges = new Range[worker_count];
+	running = true;
+
+	// Worker 0 is the thread calling ParallelFor
+	for (int32 i = 1; i < worker_count; ++i)
+		threads.push_back(std::thread(&WorkerPool::WorkerLoop, this, i));
+
+	LOG("Physics worker pool started with %d threads", worker_count);
+}
+
+void WorkerPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	wake.notify_all();
+
+	for (std::thread& thread : threads)
+		thread.join();
+	threads.clear();
+
+	delete[] ranges;
+	ranges = nullptr;
+	worker_count = 1;
+}
+
+int32 WorkerPool::GetWorkerCount() const
+{
+	return worker_count;
+}
+
+uint64 WorkerPool::GetStolenCount() const
+{
+	return stolen;
+}
+
+void WorkerPool::ParallelFor(int32 count, b2TaskFunction* function, void* data)
+{
+	// Not worth waking anyone
+	if (count <= 1 || threads.empty())
+	{
+		for (int32 i = 0; i < count; ++i)
+			function(data, i, 0);
+		return;
+	}
+
+	int32 share = count / worker_count;
+	int32 extra = count % worker_count;
+	int32 begin = 0;
+
+	for (int32 i = 0; i < worker_count; ++i)
+	{
+		int32 size = share + ((i < extra) ? 1 : 0);
+		ranges[i].next.store(begin, std::memory_order_relaxed);
+		ranges[i].end = begin + size;
+		begin += size;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = function;
+		context = data;
+		busy = worker_count - 1;
+		job++;
+	}
+	wake.notify_all();
+
+	RunTasks(0);
+
+	// The ranges and the task belong to this call until every worker is out
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return busy == 0; });
+}
+
+void WorkerPool::WorkerLoop(int32 worker)
+{
+	uint last_job = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, last_job] { return running == false || job != last_job; });
+
+			if (running == false)
+				return;
+
+			last_job = job;
+		}
+
+		RunTasks(worker);
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			last = --busy == 0;
+		}
+
+		if (last)
+			done.notify_one();
+	}
+}
+
+// Own range first, then the others starting with the next worker
+void WorkerPool::RunTasks(int32 worker)
+{
+	for (int32 i = 0; i < worker_count; ++i)
+	{
+		int32 victim = (worker + i) % worker_count;
+		Range& range = ranges[victim];
+
+		while (true)
+		{
+			int32 index = range.next.fetch_add(1, std::memory_order_relaxed);
+			if (index >= range.end)
+				break;
+
+			if (victim != worker)
+				stolen++;
+
+			task(context, index, worker);
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Globals.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// Suppress: Variable is uninitialized (C26495) for third-party Box2D types
+#pragma warning(disable : 26495)
+#endif
+#include "box2d\box2d.h"
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#define WORKER_POOL_MAX_THREADS 16
+
+// Runs the islands of a physics step on several threads. Each worker starts
+// with an even share of the tasks and, once done with it, steals tasks from
+// the others. The thread calling ParallelFor is worker 0
+class WorkerPool : public b2TaskExecutor
+{
+public:
+
+	WorkerPool();
+	~WorkerPool();
+
+	// threads = 0 uses every hardware thread, up to WORKER_POOL_MAX_THREADS
+	void Start(uint threads = 0);
+	void Stop();
+
+	int32 GetWorkerCount() const;
+	void ParallelFor(int32 count, b2TaskFunction* task, void* context);
+
+	// Tasks a worker took from another one, since Start
+	uint64 GetStolenCount() const;
+
+private:
+
+	// Tasks [next, end) not taken yet, next is advanced by the owner and thieves alike
+	struct Range
+	{
+		std::atomic<int32> next;
+		int32 end;
+		char pad[64];
+	};
+
+	void WorkerLoop(int32 worker);
+	void RunTasks(int32 worker);
+
+private:
+
+	std::vector<std::thread> threads;
+	Range* ranges;
+	int32 worker_count;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	uint job;			// ParallelFor calls so far, workers wait for the next one
+	int32 busy;			// workers still inside the current job
+	bool running;
+
+	b2TaskFunction* task;
+	void* context;
+
+	std::atomic<uint64> stolen;
+};
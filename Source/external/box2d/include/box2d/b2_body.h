@@ -333,6 +333,11 @@ public:
 	/// @return true if the body is awake.
 	bool IsAwake() const;
 
+	/// Time the body has been resting, it falls asleep once this reaches b2_timeToSleep.
+	/// Exposed to save and restore the exact state of the body.
+	float GetSleepTime() const;
+	void SetSleepTime(float time);
+
 	/// Allow a body to be disabled. A disabled body is not simulated and cannot
 	/// be collided with or woken up.
 	/// If you pass a flag of true, all fixtures will be added to the broad-phase.
@@ -432,6 +437,10 @@ private:
 
 	void Advance(float t);
 
+	// Index in the arrays of the island being solved. Static bodies shared by
+	// islands solved at the same time go through that island's remap.
+	int32 GetIslandIndex(const int32* sharedIndices) const;
+
 	b2BodyType m_type;
 
 	uint16 m_flags;
@@ -663,6 +672,16 @@ inline bool b2Body::IsAwake() const
 	return (m_flags & e_awakeFlag) == e_awakeFlag;
 }
 
+inline float b2Body::GetSleepTime() const
+{
+	return m_sleepTime;
+}
+
+inline void b2Body::SetSleepTime(float time)
+{
+	m_sleepTime = time;
+}
+
 inline bool b2Body::IsEnabled() const
 {
 	return (m_flags & e_enabledFlag) == e_enabledFlag;
@@ -868,6 +887,15 @@ inline void b2Body::Advance(float alpha)
 	m_xf.p = m_sweep.c - b2Mul(m_xf.q, m_sweep.localCenter);
 }
 
+inline int32 b2Body::GetIslandIndex(const int32* sharedIndices) const
+{
+	if (sharedIndices != nullptr && m_type == b2_staticBody)
+	{
+		return sharedIndices[m_islandIndex];
+	}
+	return m_islandIndex;
+}
+
 inline b2World* b2Body::GetWorld()
 {
 	return m_world;
@@ -103,6 +103,9 @@ public:
 	/// Get the quality metric of the embedded tree.
 	float GetTreeQuality() const;
 
+	/// Rebuild the embedded tree top down with SAH splits. Proxy ids are kept.
+	void RebuildTree();
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
@@ -169,6 +172,11 @@ inline float b2BroadPhase::GetTreeQuality() const
 	return m_tree.GetAreaRatio();
 }
 
+inline void b2BroadPhase::RebuildTree()
+{
+	m_tree.RebuildTopDown();
+}
+
 template <typename T>
 void b2BroadPhase::UpdatePairs(T* callback)
 {
@@ -210,6 +210,12 @@ protected:
 
 	void Update(b2ContactListener* listener);
 
+	// The two halves of Update. UpdateManifold only writes to this contact, so
+	// contacts may run it on different threads. FinishUpdate sets the touching
+	// flag, wakes the bodies and calls the listener.
+	bool UpdateManifold(b2Manifold* oldManifold);
+	void FinishUpdate(const b2Manifold* oldManifold, bool touching, b2ContactListener* listener);
+
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
 
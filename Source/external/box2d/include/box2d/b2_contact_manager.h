@@ -27,15 +27,19 @@
 #include "b2_broad_phase.h"
 
 class b2Contact;
+class b2Fixture;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
+class b2StackAllocator;
+class b2TaskExecutor;
 
 // Delegate of b2World.
 class B2_API b2ContactManager
 {
 public:
 	b2ContactManager();
+	~b2ContactManager();
 
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB);
@@ -46,12 +50,32 @@ public:
 
 	void Collide();
 
+	// Everything Collide does for one contact, which may be destroyed.
+	void CollideContact(b2Contact* c);
+
+	// Collide with the manifolds evaluated through the task executor.
+	void CollideParallel();
+	static void NarrowphaseTask(void* context, int32 index, int32 worker);
+
+	// Contact pair index, kept in sync by AddPair and Destroy.
+	b2Contact* FindPair(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB) const;
+	void InsertPair(b2Contact* c);
+	void RemovePair(b2Contact* c);
+	void GrowPairTable();
+
 	b2BroadPhase m_broadPhase;
 	b2Contact* m_contactList;
 	int32 m_contactCount;
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+	b2StackAllocator* m_stackAllocator;
+	b2TaskExecutor* m_taskExecutor;
+
+	// Every contact by its fixture and child index pairs. Open addressing with
+	// linear probing, the capacity is a power of two at least twice the count.
+	b2Contact** m_pairTable;
+	int32 m_pairCapacity;
 };
 
 #endif
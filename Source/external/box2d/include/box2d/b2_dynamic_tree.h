@@ -128,6 +128,11 @@ public:
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Rebuild the tree top down, splitting the leaves where the surface area
+	/// heuristic is lowest. Much cheaper than RebuildBottomUp (n log^2 n for a
+	/// balanced result) and keeps the height low. Proxy ids are kept.
+	void RebuildTopDown();
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
@@ -143,6 +148,8 @@ private:
 
 	int32 Balance(int32 index);
 
+	int32 BuildTopDown(int32* leaves, int32 count);
+
 	int32 ComputeHeight() const;
 	int32 ComputeHeight(int32 nodeId) const;
 
@@ -155,6 +155,11 @@ public:
 	/// Unit is N*m.
 	float GetMotorTorque(float inv_dt) const;
 
+	/// Accumulated impulses the solver warm starts from. Exposed to save and
+	/// restore the exact state of the joint.
+	void GetImpulses(b2Vec2& impulse, float& motorImpulse, float& lowerImpulse, float& upperImpulse) const;
+	void SetImpulses(const b2Vec2& impulse, float motorImpulse, float lowerImpulse, float upperImpulse);
+
 	/// Dump to b2Log.
 	void Dump() override;
 
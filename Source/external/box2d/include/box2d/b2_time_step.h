@@ -69,6 +69,7 @@ struct B2_API b2SolverData
 	b2TimeStep step;
 	b2Position* positions;
 	b2Velocity* velocities;
+	const int32* sharedIndices;	///< island index of each shared static body, see b2Body::GetIslandIndex
 };
 
 #endif
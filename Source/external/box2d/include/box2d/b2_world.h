@@ -66,6 +66,13 @@ public:
 	/// remain in scope.
 	void SetContactListener(b2ContactListener* listener);
 
+	/// Evaluate the contact manifolds and solve the islands of each step through
+	/// this executor, nullptr (the default) does both one after another on the
+	/// calling thread. The results are the same either way, contact listener
+	/// callbacks are made on the calling thread in the same order.
+	/// @warning not callable during a time step.
+	void SetTaskExecutor(b2TaskExecutor* executor);
+
 	/// Register a routine for debug drawing. The debug draw functions are called
 	/// inside with b2World::DebugDraw method. The debug draw object is owned
 	/// by you and must remain in scope.
@@ -184,6 +191,12 @@ public:
 	/// The minimum is 1.
 	float GetTreeQuality() const;
 
+	/// Rebuild the dynamic tree from scratch, top down with surface area heuristic
+	/// splits. Worth it once the static geometry is created: the incremental
+	/// inserts leave a tree with much more node area to walk. Not callable during
+	/// a time step.
+	void RebuildTree();
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 
@@ -222,6 +235,9 @@ private:
 	friend class b2Controller;
 
 	void Solve(const b2TimeStep& step);
+	void SolveParallel(const b2TimeStep& step);
+	static void SolveIslandTask(void* context, int32 index, int32 worker);
+	void FreeWorkerAllocators();
 	void SolveTOI(const b2TimeStep& step);
 
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
@@ -231,6 +247,10 @@ private:
 
 	b2ContactManager m_contactManager;
 
+	b2TaskExecutor* m_taskExecutor;
+	b2StackAllocator* m_workerAllocators;
+	int32 m_workerCount;
+
 	b2Body* m_bodyList;
 	b2Joint* m_jointList;
 
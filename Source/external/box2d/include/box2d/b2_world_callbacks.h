@@ -158,4 +158,23 @@ public:
 									const b2Vec2& normal, float fraction) = 0;
 };
 
+/// A task run by b2TaskExecutor. worker is in [0, b2TaskExecutor::GetWorkerCount()),
+/// tasks given the same worker never run at the same time.
+typedef void b2TaskFunction(void* context, int32 index, int32 worker);
+
+/// Implement this to run the narrow phase and solve the islands of a step on
+/// several threads. The executor is owned by you and must remain in scope.
+class B2_API b2TaskExecutor
+{
+public:
+	virtual ~b2TaskExecutor() {}
+
+	/// Number of threads that may run tasks, the calling thread included.
+	virtual int32 GetWorkerCount() const = 0;
+
+	/// Run task for every index in [0, count) in any order and return once
+	/// all of them are done.
+	virtual void ParallelFor(int32 count, b2TaskFunction* task, void* context) = 0;
+};
+
 #endif
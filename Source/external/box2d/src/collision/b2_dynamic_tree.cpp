@@ -22,6 +22,8 @@
 #include "box2d/b2_dynamic_tree.h"
 #include <string.h>
 
+#include <algorithm>
+
 b2DynamicTree::b2DynamicTree()
 {
 	m_root = b2_nullNode;
@@ -790,6 +792,136 @@ void b2DynamicTree::RebuildBottomUp()
 	Validate();
 }
 
+void b2DynamicTree::RebuildTopDown()
+{
+	int32* leaves = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+
+	// Build array of leaves. Free the rest.
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			m_nodes[i].parent = b2_nullNode;
+			leaves[count] = i;
+			++count;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	m_root = count > 0 ? BuildTopDown(leaves, count) : b2_nullNode;
+	if (m_root != b2_nullNode)
+	{
+		m_nodes[m_root].parent = b2_nullNode;
+	}
+
+	b2Free(leaves);
+
+	Validate();
+}
+
+// Returns the root of the subtree holding leaves [0, count). The split is
+// the one with the lowest surface area heuristic cost, perimeter times leaf
+// count on each side, over the leaves sorted along x and along y.
+int32 b2DynamicTree::BuildTopDown(int32* leaves, int32 count)
+{
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	const b2TreeNode* nodes = m_nodes;
+	auto byX = [nodes](int32 a, int32 b)
+	{
+		float va = nodes[a].aabb.lowerBound.x + nodes[a].aabb.upperBound.x;
+		float vb = nodes[b].aabb.lowerBound.x + nodes[b].aabb.upperBound.x;
+
+		// Ties by index so the result does not depend on the sort internals.
+		return va < vb || (va == vb && a < b);
+	};
+	auto byY = [nodes](int32 a, int32 b)
+	{
+		float va = nodes[a].aabb.lowerBound.y + nodes[a].aabb.upperBound.y;
+		float vb = nodes[b].aabb.lowerBound.y + nodes[b].aabb.upperBound.y;
+		return va < vb || (va == vb && a < b);
+	};
+
+	// Perimeter of the leaves left of each split, filled per axis.
+	float* leftCost = (float*)b2Alloc(count * sizeof(float));
+	float bestCost = b2_maxFloat;
+	int32 bestAxis = 0;
+	int32 half = count / 2;
+
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		if (axis == 0)
+		{
+			std::sort(leaves, leaves + count, byX);
+		}
+		else
+		{
+			std::sort(leaves, leaves + count, byY);
+		}
+
+		b2AABB box = m_nodes[leaves[0]].aabb;
+		for (int32 i = 1; i < count; ++i)
+		{
+			leftCost[i] = box.GetPerimeter() * i;
+			box.Combine(m_nodes[leaves[i]].aabb);
+		}
+
+		box = m_nodes[leaves[count - 1]].aabb;
+		for (int32 i = count - 1; i > 0; --i)
+		{
+			float cost = leftCost[i] + box.GetPerimeter() * (count - i);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				half = i;
+			}
+
+			box.Combine(m_nodes[leaves[i - 1]].aabb);
+		}
+	}
+
+	b2Free(leftCost);
+
+	if (bestAxis == 0)
+	{
+		std::sort(leaves, leaves + count, byX);
+	}
+
+	int32 index1 = BuildTopDown(leaves, half);
+	int32 index2 = BuildTopDown(leaves + half, count - half);
+
+	// AllocateNode may grow the pool, take the pointers after it.
+	int32 parentIndex = AllocateNode();
+	b2TreeNode* parent = m_nodes + parentIndex;
+	b2TreeNode* child1 = m_nodes + index1;
+	b2TreeNode* child2 = m_nodes + index2;
+
+	parent->child1 = index1;
+	parent->child2 = index2;
+	parent->height = 1 + b2Max(child1->height, child2->height);
+	parent->aabb.Combine(child1->aabb, child2->aabb);
+	parent->parent = b2_nullNode;
+
+	child1->parent = parentIndex;
+	child2->parent = parentIndex;
+
+	return parentIndex;
+}
+
 void b2DynamicTree::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	// Build array of leaves. Free the rest.
@@ -24,8 +24,17 @@
 #include "box2d/b2_contact.h"
 #include "box2d/b2_contact_manager.h"
 #include "box2d/b2_fixture.h"
+#include "box2d/b2_stack_allocator.h"
 #include "box2d/b2_world_callbacks.h"
 
+#include <string.h>
+
+// Contacts evaluated by one narrowphase task.
+#define B2_NARROWPHASE_CHUNK 32
+
+// Slots of the contact pair table when the first contact is added.
+#define B2_PAIR_TABLE_MIN 64
+
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
 
@@ -36,6 +45,152 @@ b2ContactManager::b2ContactManager()
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
 	m_allocator = nullptr;
+	m_stackAllocator = nullptr;
+	m_taskExecutor = nullptr;
+	m_pairTable = nullptr;
+	m_pairCapacity = 0;
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	b2Free(m_pairTable);
+}
+
+static inline uint32 b2HashFixture(const b2Fixture* fixture, int32 childIndex)
+{
+	uintptr_t p = (uintptr_t)fixture;
+	uint32 h = (uint32)(p ^ (p >> 16 >> 16)) * 0x9E3779B1u + (uint32)childIndex * 0x85EBCA77u;
+
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+// The sum does not depend on which fixture is A, contact creation may swap them.
+static inline uint32 b2HashPair(const b2Fixture* fixtureA, int32 indexA, const b2Fixture* fixtureB, int32 indexB)
+{
+	return b2HashFixture(fixtureA, indexA) + b2HashFixture(fixtureB, indexB);
+}
+
+static inline bool b2IsPair(const b2Contact* c, const b2Fixture* fixtureA, int32 indexA, const b2Fixture* fixtureB, int32 indexB)
+{
+	const b2Fixture* fA = c->GetFixtureA();
+	const b2Fixture* fB = c->GetFixtureB();
+	int32 iA = c->GetChildIndexA();
+	int32 iB = c->GetChildIndexB();
+
+	return (fA == fixtureA && fB == fixtureB && iA == indexA && iB == indexB) ||
+		(fA == fixtureB && fB == fixtureA && iA == indexB && iB == indexA);
+}
+
+b2Contact* b2ContactManager::FindPair(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB) const
+{
+	if (m_pairCapacity == 0)
+	{
+		return nullptr;
+	}
+
+	uint32 mask = m_pairCapacity - 1;
+	uint32 i = b2HashPair(fixtureA, indexA, fixtureB, indexB) & mask;
+
+	while (m_pairTable[i] != nullptr)
+	{
+		if (b2IsPair(m_pairTable[i], fixtureA, indexA, fixtureB, indexB))
+		{
+			return m_pairTable[i];
+		}
+
+		i = (i + 1) & mask;
+	}
+
+	return nullptr;
+}
+
+void b2ContactManager::InsertPair(b2Contact* c)
+{
+	if (2 * (m_contactCount + 1) > m_pairCapacity)
+	{
+		GrowPairTable();
+	}
+
+	uint32 mask = m_pairCapacity - 1;
+	uint32 i = b2HashPair(c->GetFixtureA(), c->GetChildIndexA(), c->GetFixtureB(), c->GetChildIndexB()) & mask;
+
+	while (m_pairTable[i] != nullptr)
+	{
+		i = (i + 1) & mask;
+	}
+
+	m_pairTable[i] = c;
+}
+
+// Backward shift deletion, so lookups never need tombstones.
+void b2ContactManager::RemovePair(b2Contact* c)
+{
+	uint32 mask = m_pairCapacity - 1;
+	uint32 i = b2HashPair(c->GetFixtureA(), c->GetChildIndexA(), c->GetFixtureB(), c->GetChildIndexB()) & mask;
+
+	while (m_pairTable[i] != c)
+	{
+		b2Assert(m_pairTable[i] != nullptr);
+		i = (i + 1) & mask;
+	}
+
+	m_pairTable[i] = nullptr;
+
+	uint32 j = i;
+	while (true)
+	{
+		j = (j + 1) & mask;
+		b2Contact* other = m_pairTable[j];
+		if (other == nullptr)
+		{
+			break;
+		}
+
+		// Move it into the hole unless its home slot lies cyclically in (i, j].
+		uint32 home = b2HashPair(other->GetFixtureA(), other->GetChildIndexA(), other->GetFixtureB(), other->GetChildIndexB()) & mask;
+		bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+		if (stays == false)
+		{
+			m_pairTable[i] = other;
+			m_pairTable[j] = nullptr;
+			i = j;
+		}
+	}
+}
+
+void b2ContactManager::GrowPairTable()
+{
+	b2Contact** oldTable = m_pairTable;
+	int32 oldCapacity = m_pairCapacity;
+
+	m_pairCapacity = b2Max(2 * oldCapacity, B2_PAIR_TABLE_MIN);
+	m_pairTable = (b2Contact**)b2Alloc(m_pairCapacity * sizeof(b2Contact*));
+	memset(m_pairTable, 0, m_pairCapacity * sizeof(b2Contact*));
+
+	uint32 mask = m_pairCapacity - 1;
+	for (int32 i = 0; i < oldCapacity; ++i)
+	{
+		b2Contact* c = oldTable[i];
+		if (c == nullptr)
+		{
+			continue;
+		}
+
+		uint32 j = b2HashPair(c->GetFixtureA(), c->GetChildIndexA(), c->GetFixtureB(), c->GetChildIndexB()) & mask;
+		while (m_pairTable[j] != nullptr)
+		{
+			j = (j + 1) & mask;
+		}
+
+		m_pairTable[j] = c;
+	}
+
+	b2Free(oldTable);
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -98,6 +253,8 @@ void b2ContactManager::Destroy(b2Contact* c)
 		bodyB->m_contactList = c->m_nodeB.next;
 	}
 
+	RemovePair(c);
+
 	// Call the factory.
 	b2Contact::Destroy(c, m_allocator);
 	--m_contactCount;
@@ -108,69 +265,165 @@ void b2ContactManager::Destroy(b2Contact* c)
 // contact list.
 void b2ContactManager::Collide()
 {
+	if (m_taskExecutor != nullptr)
+	{
+		CollideParallel();
+		return;
+	}
+
 	// Update awake contacts.
 	b2Contact* c = m_contactList;
 	while (c)
+	{
+		b2Contact* cNext = c->GetNext();
+		CollideContact(c);
+		c = cNext;
+	}
+}
+
+void b2ContactManager::CollideContact(b2Contact* c)
+{
+	b2Fixture* fixtureA = c->GetFixtureA();
+	b2Fixture* fixtureB = c->GetFixtureB();
+	int32 indexA = c->GetChildIndexA();
+	int32 indexB = c->GetChildIndexB();
+	b2Body* bodyA = fixtureA->GetBody();
+	b2Body* bodyB = fixtureB->GetBody();
+
+	// Is this contact flagged for filtering?
+	if (c->m_flags & b2Contact::e_filterFlag)
+	{
+		// Should these bodies collide?
+		if (bodyB->ShouldCollide(bodyA) == false)
+		{
+			Destroy(c);
+			return;
+		}
+
+		// Check user filtering.
+		if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+		{
+			Destroy(c);
+			return;
+		}
+
+		// Clear the filtering flag.
+		c->m_flags &= ~b2Contact::e_filterFlag;
+	}
+
+	bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+	bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+
+	// At least one body must be awake and it must be dynamic or kinematic.
+	if (activeA == false && activeB == false)
+	{
+		return;
+	}
+
+	int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
+	int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
+	bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+
+	// Here we destroy contacts that cease to overlap in the broad-phase.
+	if (overlap == false)
+	{
+		Destroy(c);
+		return;
+	}
+
+	// The contact persists.
+	c->Update(m_contactListener);
+}
+
+struct b2NarrowphaseEntry
+{
+	b2Contact* contact;
+	b2Manifold oldManifold;
+	bool evaluate;
+	bool touching;
+};
+
+struct b2NarrowphaseTasks
+{
+	b2NarrowphaseEntry* entries;
+	int32 count;
+};
+
+void b2ContactManager::NarrowphaseTask(void* context, int32 index, int32 worker)
+{
+	B2_NOT_USED(worker);
+
+	b2NarrowphaseTasks* tasks = (b2NarrowphaseTasks*)context;
+	int32 begin = index * B2_NARROWPHASE_CHUNK;
+	int32 end = b2Min(begin + B2_NARROWPHASE_CHUNK, tasks->count);
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2NarrowphaseEntry* entry = tasks->entries + i;
+		if (entry->evaluate)
+		{
+			entry->touching = entry->contact->UpdateManifold(&entry->oldManifold);
+		}
+	}
+}
+
+// Same result as the serial Collide. The contacts that surely persist get their
+// manifolds evaluated in parallel chunks. Then, in contact list order, those are
+// finished and every other contact goes through CollideContact, so filtering,
+// destruction, waking and the listener calls happen as they would serially. A
+// body woken by an earlier contact is seen by the later ones, like before.
+// Sensors stay serial since b2TestOverlap bumps the global GJK counters.
+void b2ContactManager::CollideParallel()
+{
+	b2NarrowphaseTasks tasks;
+	tasks.entries = (b2NarrowphaseEntry*)m_stackAllocator->Allocate(m_contactCount * sizeof(b2NarrowphaseEntry));
+	tasks.count = 0;
+
+	for (b2Contact* c = m_contactList; c; c = c->GetNext())
 	{
 		b2Fixture* fixtureA = c->GetFixtureA();
 		b2Fixture* fixtureB = c->GetFixtureB();
-		int32 indexA = c->GetChildIndexA();
-		int32 indexB = c->GetChildIndexB();
 		b2Body* bodyA = fixtureA->GetBody();
 		b2Body* bodyB = fixtureB->GetBody();
-		 
-		// Is this contact flagged for filtering?
-		if (c->m_flags & b2Contact::e_filterFlag)
+
+		b2NarrowphaseEntry* entry = tasks.entries + tasks.count++;
+		entry->contact = c;
+		entry->evaluate = false;
+
+		if ((c->m_flags & b2Contact::e_filterFlag) || fixtureA->IsSensor() || fixtureB->IsSensor())
 		{
-			// Should these bodies collide?
-			if (bodyB->ShouldCollide(bodyA) == false)
-			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
-				continue;
-			}
-
-			// Check user filtering.
-			if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
-			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
-				continue;
-			}
-
-			// Clear the filtering flag.
-			c->m_flags &= ~b2Contact::e_filterFlag;
+			continue;
 		}
 
 		bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
 		bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
-
-		// At least one body must be awake and it must be dynamic or kinematic.
 		if (activeA == false && activeB == false)
 		{
-			c = c->GetNext();
 			continue;
 		}
 
-		int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
-		int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
-		bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+		int32 proxyIdA = fixtureA->m_proxies[c->GetChildIndexA()].proxyId;
+		int32 proxyIdB = fixtureB->m_proxies[c->GetChildIndexB()].proxyId;
+		entry->evaluate = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+	}
+
+	int32 taskCount = (tasks.count + B2_NARROWPHASE_CHUNK - 1) / B2_NARROWPHASE_CHUNK;
+	m_taskExecutor->ParallelFor(taskCount, &b2ContactManager::NarrowphaseTask, &tasks);
 
-		// Here we destroy contacts that cease to overlap in the broad-phase.
-		if (overlap == false)
+	for (int32 i = 0; i < tasks.count; ++i)
+	{
+		b2NarrowphaseEntry* entry = tasks.entries + i;
+		if (entry->evaluate)
 		{
-			b2Contact* cNuke = c;
-			c = cNuke->GetNext();
-			Destroy(cNuke);
-			continue;
+			entry->contact->FinishUpdate(&entry->oldManifold, entry->touching, m_contactListener);
+		}
+		else
+		{
+			CollideContact(entry->contact);
 		}
-
-		// The contact persists.
-		c->Update(m_contactListener);
-		c = c->GetNext();
 	}
+
+	m_stackAllocator->Free(tasks.entries);
 }
 
 void b2ContactManager::FindNewContacts()
@@ -198,33 +451,10 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 		return;
 	}
 
-	// TODO_ERIN use a hash table to remove a potential bottleneck when both
-	// bodies have a lot of contacts.
 	// Does a contact already exist?
-	b2ContactEdge* edge = bodyB->GetContactList();
-	while (edge)
+	if (FindPair(fixtureA, indexA, fixtureB, indexB) != nullptr)
 	{
-		if (edge->other == bodyA)
-		{
-			b2Fixture* fA = edge->contact->GetFixtureA();
-			b2Fixture* fB = edge->contact->GetFixtureB();
-			int32 iA = edge->contact->GetChildIndexA();
-			int32 iB = edge->contact->GetChildIndexB();
-
-			if (fA == fixtureA && fB == fixtureB && iA == indexA && iB == indexB)
-			{
-				// A contact already exists.
-				return;
-			}
-
-			if (fA == fixtureB && fB == fixtureA && iA == indexB && iB == indexA)
-			{
-				// A contact already exists.
-				return;
-			}
-		}
-
-		edge = edge->next;
+		return;
 	}
 
 	// Does a joint override collision? Is at least one body dynamic?
@@ -289,5 +519,6 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	}
 	bodyB->m_contactList = &c->m_nodeB;
 
+	InsertPair(c);
 	++m_contactCount;
 }
@@ -28,11 +28,28 @@
 #include "box2d/b2_stack_allocator.h"
 #include "box2d/b2_world.h"
 
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define B2_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define B2_SIMD_SSE2 0
+#endif
+
+// Below this many one point contacts the colouring costs more than it saves.
+#define B2_WIDE_MIN_CONTACTS 8
+
 // Solver debugging is normally disabled because the block solver sometimes has to deal with a poorly conditioned effective mass matrix.
 #define B2_DEBUG_SOLVER 0
 
 B2_API bool g_blockSolve = true;
 
+/// Solve the velocity and position constraints of one point contacts four at a
+/// time with SSE2. Every x64 CPU has it, so it is on whenever the build targets
+/// it. It changes the solve order, and so the results, compared to the scalar solver.
+B2_API bool g_wideSolve = B2_SIMD_SSE2 != 0;
+
 struct b2ContactPositionConstraint
 {
 	b2Vec2 localPoints[b2_maxManifoldPoints];
@@ -58,6 +75,15 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	m_positions = def->positions;
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
+	const int32* sharedIndices = def->sharedIndices;
+
+	m_scalarIndices = nullptr;
+	m_scalarCount = m_count;
+	m_wideConstraints = nullptr;
+	m_widePositions = nullptr;
+	m_wideCount = 0;
+	m_bodyColors = nullptr;
+	m_wideOrder = nullptr;
 
 	// Initialize position independent portions of the constraints.
 	for (int32 i = 0; i < m_count; ++i)
@@ -82,8 +108,8 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		vc->restitution = contact->m_restitution;
 		vc->threshold = contact->m_restitutionThreshold;
 		vc->tangentSpeed = contact->m_tangentSpeed;
-		vc->indexA = bodyA->m_islandIndex;
-		vc->indexB = bodyB->m_islandIndex;
+		vc->indexA = bodyA->GetIslandIndex(sharedIndices);
+		vc->indexB = bodyB->GetIslandIndex(sharedIndices);
 		vc->invMassA = bodyA->m_invMass;
 		vc->invMassB = bodyB->m_invMass;
 		vc->invIA = bodyA->m_invI;
@@ -94,8 +120,8 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		vc->normalMass.SetZero();
 
 		b2ContactPositionConstraint* pc = m_positionConstraints + i;
-		pc->indexA = bodyA->m_islandIndex;
-		pc->indexB = bodyB->m_islandIndex;
+		pc->indexA = vc->indexA;
+		pc->indexB = vc->indexB;
 		pc->invMassA = bodyA->m_invMass;
 		pc->invMassB = bodyB->m_invMass;
 		pc->localCenterA = bodyA->m_sweep.localCenter;
@@ -138,6 +164,15 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 
 b2ContactSolver::~b2ContactSolver()
 {
+	if (m_bodyColors != nullptr)
+	{
+		m_allocator->Free(m_widePositions);
+		m_allocator->Free(m_wideConstraints);
+		m_allocator->Free(m_scalarIndices);
+		m_allocator->Free(m_wideOrder);
+		m_allocator->Free(m_bodyColors);
+	}
+
 	m_allocator->Free(m_velocityConstraints);
 	m_allocator->Free(m_positionConstraints);
 }
@@ -252,6 +287,163 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			}
 		}
 	}
+
+	PrepareWideConstraints();
+}
+
+// Colour the one point contacts so that no dynamic body appears twice in a colour.
+// Static and kinematic bodies may be shared since the solver never changes them.
+// Each colour is then cut into batches of four, keeping the contact order. The
+// position solver uses the same batches, so the position constraint must have
+// one point too: a redundant two point manifold solves one velocity point only.
+void b2ContactSolver::PrepareWideConstraints()
+{
+#if B2_SIMD_SSE2
+	if (g_wideSolve == false || m_count < B2_WIDE_MIN_CONTACTS)
+	{
+		return;
+	}
+
+	int32 bodyCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		bodyCount = b2Max(bodyCount, b2Max(vc->indexA, vc->indexB) + 1);
+	}
+
+	m_bodyColors = (uint32*)m_allocator->Allocate(bodyCount * sizeof(uint32));
+	m_wideOrder = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+	m_scalarIndices = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+	memset(m_bodyColors, 0, bodyCount * sizeof(uint32));
+
+	// m_wideOrder holds the colour of each constraint, -1 when left to the scalar solver.
+	int32 colorCounts[32] = { 0 };
+	int32 wideTotal = 0;
+	m_scalarCount = 0;
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		int32 color = -1;
+
+		if (vc->pointCount == 1 && m_positionConstraints[i].pointCount == 1)
+		{
+			bool dynamicA = vc->invMassA > 0.0f || vc->invIA > 0.0f;
+			bool dynamicB = vc->invMassB > 0.0f || vc->invIB > 0.0f;
+			uint32 used = (dynamicA ? m_bodyColors[vc->indexA] : 0) | (dynamicB ? m_bodyColors[vc->indexB] : 0);
+
+			if (used != 0xFFFFFFFF)
+			{
+				color = 0;
+				while (used & (1u << color))
+				{
+					++color;
+				}
+
+				if (dynamicA)
+				{
+					m_bodyColors[vc->indexA] |= 1u << color;
+				}
+
+				if (dynamicB)
+				{
+					m_bodyColors[vc->indexB] |= 1u << color;
+				}
+
+				++colorCounts[color];
+				++wideTotal;
+			}
+		}
+
+		if (color < 0)
+		{
+			m_scalarIndices[m_scalarCount++] = i;
+		}
+
+		m_wideOrder[i] = color;
+	}
+
+	if (wideTotal < B2_WIDE_MIN_CONTACTS)
+	{
+		m_allocator->Free(m_scalarIndices);
+		m_allocator->Free(m_wideOrder);
+		m_allocator->Free(m_bodyColors);
+		m_scalarIndices = nullptr;
+		m_wideOrder = nullptr;
+		m_bodyColors = nullptr;
+		m_scalarCount = m_count;
+		return;
+	}
+
+	int32 batchStart[32];
+	int32 batchCount = 0;
+	for (int32 c = 0; c < 32; ++c)
+	{
+		batchStart[c] = batchCount;
+		batchCount += (colorCounts[c] + 3) / 4;
+	}
+
+	m_wideCount = batchCount;
+	m_wideConstraints = (b2WideConstraint*)m_allocator->Allocate(batchCount * sizeof(b2WideConstraint));
+	memset(m_wideConstraints, 0, batchCount * sizeof(b2WideConstraint));
+	m_widePositions = (b2WidePositionConstraint*)m_allocator->Allocate(batchCount * sizeof(b2WidePositionConstraint));
+	memset(m_widePositions, 0, batchCount * sizeof(b2WidePositionConstraint));
+
+	int32 filled[32] = { 0 };
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		int32 color = m_wideOrder[i];
+		if (color < 0)
+		{
+			continue;
+		}
+
+		const b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		const b2VelocityConstraintPoint* vcp = vc->points;
+		const b2ContactPositionConstraint* pc = m_positionConstraints + i;
+		int32 batch = batchStart[color] + filled[color] / 4;
+		b2WideConstraint* wc = m_wideConstraints + batch;
+		b2WidePositionConstraint* wp = m_widePositions + batch;
+		int32 lane = filled[color] % 4;
+		++filled[color];
+
+		wc->normalX[lane] = vc->normal.x;
+		wc->normalY[lane] = vc->normal.y;
+		wc->rAX[lane] = vcp->rA.x;
+		wc->rAY[lane] = vcp->rA.y;
+		wc->rBX[lane] = vcp->rB.x;
+		wc->rBY[lane] = vcp->rB.y;
+		wc->invMassA[lane] = vc->invMassA;
+		wc->invIA[lane] = vc->invIA;
+		wc->invMassB[lane] = vc->invMassB;
+		wc->invIB[lane] = vc->invIB;
+		wc->friction[lane] = vc->friction;
+		wc->tangentSpeed[lane] = vc->tangentSpeed;
+		wc->normalMass[lane] = vcp->normalMass;
+		wc->tangentMass[lane] = vcp->tangentMass;
+		wc->velocityBias[lane] = vcp->velocityBias;
+		wc->normalImpulse[lane] = vcp->normalImpulse;
+		wc->tangentImpulse[lane] = vcp->tangentImpulse;
+		wc->indexA[lane] = vc->indexA;
+		wc->indexB[lane] = vc->indexB;
+		wc->constraint[lane] = i;
+		wc->count = lane + 1;
+
+		wp->localNormalX[lane] = pc->localNormal.x;
+		wp->localNormalY[lane] = pc->localNormal.y;
+		wp->localPointX[lane] = pc->localPoint.x;
+		wp->localPointY[lane] = pc->localPoint.y;
+		wp->incidentPointX[lane] = pc->localPoints[0].x;
+		wp->incidentPointY[lane] = pc->localPoints[0].y;
+		wp->localCenterAX[lane] = pc->localCenterA.x;
+		wp->localCenterAY[lane] = pc->localCenterA.y;
+		wp->localCenterBX[lane] = pc->localCenterB.x;
+		wp->localCenterBY[lane] = pc->localCenterB.y;
+		wp->radius[lane] = pc->radiusA + pc->radiusB;
+		wp->circles[lane] = pc->type == b2Manifold::e_circles ? 1.0f : 0.0f;
+		wp->faceB[lane] = pc->type == b2Manifold::e_faceB ? 1.0f : 0.0f;
+	}
+#endif
 }
 
 void b2ContactSolver::WarmStart()
@@ -294,10 +486,138 @@ void b2ContactSolver::WarmStart()
 	}
 }
 
+// Same math as the one point case of SolveVelocityConstraints, four lanes at a time.
+void b2ContactSolver::SolveWideVelocityConstraints()
+{
+#if B2_SIMD_SSE2
+	const __m128 zero = _mm_setzero_ps();
+
+	for (int32 i = 0; i < m_wideCount; ++i)
+	{
+		b2WideConstraint* wc = m_wideConstraints + i;
+		int32 count = wc->count;
+
+		// Gather. Padding lanes stay at zero and are never written back.
+		float vAX[4] = { 0 }, vAY[4] = { 0 }, wAs[4] = { 0 };
+		float vBX[4] = { 0 }, vBY[4] = { 0 }, wBs[4] = { 0 };
+		for (int32 lane = 0; lane < count; ++lane)
+		{
+			const b2Velocity& a = m_velocities[wc->indexA[lane]];
+			const b2Velocity& b = m_velocities[wc->indexB[lane]];
+			vAX[lane] = a.v.x;
+			vAY[lane] = a.v.y;
+			wAs[lane] = a.w;
+			vBX[lane] = b.v.x;
+			vBY[lane] = b.v.y;
+			wBs[lane] = b.w;
+		}
+
+		__m128 vax = _mm_loadu_ps(vAX), vay = _mm_loadu_ps(vAY), wa = _mm_loadu_ps(wAs);
+		__m128 vbx = _mm_loadu_ps(vBX), vby = _mm_loadu_ps(vBY), wb = _mm_loadu_ps(wBs);
+
+		__m128 nx = _mm_loadu_ps(wc->normalX), ny = _mm_loadu_ps(wc->normalY);
+		__m128 rax = _mm_loadu_ps(wc->rAX), ray = _mm_loadu_ps(wc->rAY);
+		__m128 rbx = _mm_loadu_ps(wc->rBX), rby = _mm_loadu_ps(wc->rBY);
+		__m128 mA = _mm_loadu_ps(wc->invMassA), iA = _mm_loadu_ps(wc->invIA);
+		__m128 mB = _mm_loadu_ps(wc->invMassB), iB = _mm_loadu_ps(wc->invIB);
+
+		// tangent = b2Cross(normal, 1.0f)
+		__m128 tx = ny;
+		__m128 ty = _mm_sub_ps(zero, nx);
+
+		// Solve tangent constraints first because non-penetration is more important
+		// than friction.
+		{
+			// Relative velocity at contact
+			__m128 dvx = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(vbx, _mm_mul_ps(wb, rby)), vax), _mm_mul_ps(wa, ray));
+			__m128 dvy = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(vby, _mm_mul_ps(wb, rbx)), vay), _mm_mul_ps(wa, rax));
+
+			// Compute tangent force
+			__m128 vt = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(dvx, tx), _mm_mul_ps(dvy, ty)), _mm_loadu_ps(wc->tangentSpeed));
+			__m128 lambda = _mm_mul_ps(_mm_loadu_ps(wc->tangentMass), _mm_sub_ps(zero, vt));
+
+			// b2Clamp the accumulated force
+			__m128 maxFriction = _mm_mul_ps(_mm_loadu_ps(wc->friction), _mm_loadu_ps(wc->normalImpulse));
+			__m128 oldImpulse = _mm_loadu_ps(wc->tangentImpulse);
+			__m128 newImpulse = _mm_max_ps(_mm_sub_ps(zero, maxFriction), _mm_min_ps(_mm_add_ps(oldImpulse, lambda), maxFriction));
+			lambda = _mm_sub_ps(newImpulse, oldImpulse);
+			_mm_storeu_ps(wc->tangentImpulse, newImpulse);
+
+			// Apply contact impulse
+			__m128 px = _mm_mul_ps(lambda, tx);
+			__m128 py = _mm_mul_ps(lambda, ty);
+
+			vax = _mm_sub_ps(vax, _mm_mul_ps(mA, px));
+			vay = _mm_sub_ps(vay, _mm_mul_ps(mA, py));
+			wa = _mm_sub_ps(wa, _mm_mul_ps(iA, _mm_sub_ps(_mm_mul_ps(rax, py), _mm_mul_ps(ray, px))));
+
+			vbx = _mm_add_ps(vbx, _mm_mul_ps(mB, px));
+			vby = _mm_add_ps(vby, _mm_mul_ps(mB, py));
+			wb = _mm_add_ps(wb, _mm_mul_ps(iB, _mm_sub_ps(_mm_mul_ps(rbx, py), _mm_mul_ps(rby, px))));
+		}
+
+		// Solve normal constraints
+		{
+			// Relative velocity at contact
+			__m128 dvx = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(vbx, _mm_mul_ps(wb, rby)), vax), _mm_mul_ps(wa, ray));
+			__m128 dvy = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(vby, _mm_mul_ps(wb, rbx)), vay), _mm_mul_ps(wa, rax));
+
+			// Compute normal impulse
+			__m128 vn = _mm_add_ps(_mm_mul_ps(dvx, nx), _mm_mul_ps(dvy, ny));
+			__m128 lambda = _mm_mul_ps(_mm_sub_ps(zero, _mm_loadu_ps(wc->normalMass)), _mm_sub_ps(vn, _mm_loadu_ps(wc->velocityBias)));
+
+			// b2Clamp the accumulated impulse
+			__m128 oldImpulse = _mm_loadu_ps(wc->normalImpulse);
+			__m128 newImpulse = _mm_max_ps(_mm_add_ps(oldImpulse, lambda), zero);
+			lambda = _mm_sub_ps(newImpulse, oldImpulse);
+			_mm_storeu_ps(wc->normalImpulse, newImpulse);
+
+			// Apply contact impulse
+			__m128 px = _mm_mul_ps(lambda, nx);
+			__m128 py = _mm_mul_ps(lambda, ny);
+
+			vax = _mm_sub_ps(vax, _mm_mul_ps(mA, px));
+			vay = _mm_sub_ps(vay, _mm_mul_ps(mA, py));
+			wa = _mm_sub_ps(wa, _mm_mul_ps(iA, _mm_sub_ps(_mm_mul_ps(rax, py), _mm_mul_ps(ray, px))));
+
+			vbx = _mm_add_ps(vbx, _mm_mul_ps(mB, px));
+			vby = _mm_add_ps(vby, _mm_mul_ps(mB, py));
+			wb = _mm_add_ps(wb, _mm_mul_ps(iB, _mm_sub_ps(_mm_mul_ps(rbx, py), _mm_mul_ps(rby, px))));
+		}
+
+		_mm_storeu_ps(vAX, vax);
+		_mm_storeu_ps(vAY, vay);
+		_mm_storeu_ps(wAs, wa);
+		_mm_storeu_ps(vBX, vbx);
+		_mm_storeu_ps(vBY, vby);
+		_mm_storeu_ps(wBs, wb);
+
+		// Scatter. Lanes only share static or kinematic bodies, whose velocities come
+		// back unchanged. The impulses go back too, b2Island::Report reads them.
+		for (int32 lane = 0; lane < count; ++lane)
+		{
+			b2Velocity& a = m_velocities[wc->indexA[lane]];
+			b2Velocity& b = m_velocities[wc->indexB[lane]];
+			a.v.Set(vAX[lane], vAY[lane]);
+			a.w = wAs[lane];
+			b.v.Set(vBX[lane], vBY[lane]);
+			b.w = wBs[lane];
+
+			b2VelocityConstraintPoint* vcp = m_velocityConstraints[wc->constraint[lane]].points;
+			vcp->normalImpulse = wc->normalImpulse[lane];
+			vcp->tangentImpulse = wc->tangentImpulse[lane];
+		}
+	}
+#endif
+}
+
 void b2ContactSolver::SolveVelocityConstraints()
 {
-	for (int32 i = 0; i < m_count; ++i)
+	SolveWideVelocityConstraints();
+
+	for (int32 s = 0; s < m_scalarCount; ++s)
 	{
+		int32 i = (m_scalarIndices != nullptr) ? m_scalarIndices[s] : s;
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
 		int32 indexA = vc->indexA;
@@ -672,13 +992,180 @@ struct b2PositionSolverManifold
 	float separation;
 };
 
+#if B2_SIMD_SSE2
+// mask ? a : b for every lane
+static inline __m128 b2Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+// Same math as the one point case of SolvePositionConstraints, four lanes at a time.
+// SSE2 has no sine or cosine, so the rotations are built while gathering. Returns
+// the smallest separation found, zero without wide constraints.
+float b2ContactSolver::SolveWidePositionConstraints()
+{
+	float minSeparation = 0.0f;
+
+#if B2_SIMD_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 epsilon = _mm_set1_ps(b2_epsilon);
+	const __m128 baumgarte = _mm_set1_ps(b2_baumgarte);
+	const __m128 slop = _mm_set1_ps(b2_linearSlop);
+	const __m128 maxCorrection = _mm_set1_ps(-b2_maxLinearCorrection);
+	__m128 minSep = zero;
+
+	for (int32 i = 0; i < m_wideCount; ++i)
+	{
+		const b2WideConstraint* wc = m_wideConstraints + i;
+		const b2WidePositionConstraint* wp = m_widePositions + i;
+		int32 count = wc->count;
+
+		// Gather. Padding lanes stay at zero, separate by zero and are never written back.
+		float cAX[4] = { 0 }, cAY[4] = { 0 }, aAs[4] = { 0 }, sinA[4] = { 0 }, cosA[4] = { 0 };
+		float cBX[4] = { 0 }, cBY[4] = { 0 }, aBs[4] = { 0 }, sinB[4] = { 0 }, cosB[4] = { 0 };
+		for (int32 lane = 0; lane < count; ++lane)
+		{
+			const b2Position& a = m_positions[wc->indexA[lane]];
+			const b2Position& b = m_positions[wc->indexB[lane]];
+			cAX[lane] = a.c.x;
+			cAY[lane] = a.c.y;
+			aAs[lane] = a.a;
+			sinA[lane] = sinf(a.a);
+			cosA[lane] = cosf(a.a);
+			cBX[lane] = b.c.x;
+			cBY[lane] = b.c.y;
+			aBs[lane] = b.a;
+			sinB[lane] = sinf(b.a);
+			cosB[lane] = cosf(b.a);
+		}
+
+		__m128 cax = _mm_loadu_ps(cAX), cay = _mm_loadu_ps(cAY), aa = _mm_loadu_ps(aAs);
+		__m128 cbx = _mm_loadu_ps(cBX), cby = _mm_loadu_ps(cBY), ab = _mm_loadu_ps(aBs);
+		__m128 sa = _mm_loadu_ps(sinA), ca = _mm_loadu_ps(cosA);
+		__m128 sb = _mm_loadu_ps(sinB), cb = _mm_loadu_ps(cosB);
+
+		__m128 mA = _mm_loadu_ps(wc->invMassA), iA = _mm_loadu_ps(wc->invIA);
+		__m128 mB = _mm_loadu_ps(wc->invMassB), iB = _mm_loadu_ps(wc->invIB);
+
+		// xf.p = c - b2Mul(xf.q, localCenter)
+		__m128 lcax = _mm_loadu_ps(wp->localCenterAX), lcay = _mm_loadu_ps(wp->localCenterAY);
+		__m128 lcbx = _mm_loadu_ps(wp->localCenterBX), lcby = _mm_loadu_ps(wp->localCenterBY);
+		__m128 pax = _mm_sub_ps(cax, _mm_sub_ps(_mm_mul_ps(ca, lcax), _mm_mul_ps(sa, lcay)));
+		__m128 pay = _mm_sub_ps(cay, _mm_add_ps(_mm_mul_ps(sa, lcax), _mm_mul_ps(ca, lcay)));
+		__m128 pbx = _mm_sub_ps(cbx, _mm_sub_ps(_mm_mul_ps(cb, lcbx), _mm_mul_ps(sb, lcby)));
+		__m128 pby = _mm_sub_ps(cby, _mm_add_ps(_mm_mul_ps(sb, lcbx), _mm_mul_ps(cb, lcby)));
+
+		// The reference body holds localPoint and localNormal: B for e_faceB, A otherwise.
+		// The other one holds the incident point.
+		__m128 faceB = _mm_cmpgt_ps(_mm_loadu_ps(wp->faceB), zero);
+		__m128 circles = _mm_cmpgt_ps(_mm_loadu_ps(wp->circles), zero);
+		__m128 sr = b2Select(faceB, sb, sa), cr = b2Select(faceB, cb, ca);
+		__m128 prx = b2Select(faceB, pbx, pax), pry = b2Select(faceB, pby, pay);
+		__m128 si = b2Select(faceB, sa, sb), ci = b2Select(faceB, ca, cb);
+		__m128 pix = b2Select(faceB, pax, pbx), piy = b2Select(faceB, pay, pby);
+
+		__m128 lpx = _mm_loadu_ps(wp->localPointX), lpy = _mm_loadu_ps(wp->localPointY);
+		__m128 planeX = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(cr, lpx), _mm_mul_ps(sr, lpy)), prx);
+		__m128 planeY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sr, lpx), _mm_mul_ps(cr, lpy)), pry);
+
+		__m128 ipx = _mm_loadu_ps(wp->incidentPointX), ipy = _mm_loadu_ps(wp->incidentPointY);
+		__m128 clipX = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ci, ipx), _mm_mul_ps(si, ipy)), pix);
+		__m128 clipY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(si, ipx), _mm_mul_ps(ci, ipy)), piy);
+
+		__m128 dx = _mm_sub_ps(clipX, planeX);
+		__m128 dy = _mm_sub_ps(clipY, planeY);
+
+		// Faces: the reference normal. Circles: the direction between the points,
+		// left as is when too short like b2Vec2::Normalize does.
+		__m128 lnx = _mm_loadu_ps(wp->localNormalX), lny = _mm_loadu_ps(wp->localNormalY);
+		__m128 fnx = _mm_sub_ps(_mm_mul_ps(cr, lnx), _mm_mul_ps(sr, lny));
+		__m128 fny = _mm_add_ps(_mm_mul_ps(sr, lnx), _mm_mul_ps(cr, lny));
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+		__m128 longEnough = _mm_cmpge_ps(length, epsilon);
+		__m128 invLength = _mm_div_ps(one, b2Select(longEnough, length, one));
+		__m128 cnx = b2Select(longEnough, _mm_mul_ps(dx, invLength), dx);
+		__m128 cny = b2Select(longEnough, _mm_mul_ps(dy, invLength), dy);
+
+		__m128 nx = b2Select(circles, cnx, fnx);
+		__m128 ny = b2Select(circles, cny, fny);
+		__m128 separation = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(dx, nx), _mm_mul_ps(dy, ny)), _mm_loadu_ps(wp->radius));
+
+		// Ensure normal points from A to B
+		nx = b2Select(faceB, _mm_sub_ps(zero, nx), nx);
+		ny = b2Select(faceB, _mm_sub_ps(zero, ny), ny);
+
+		__m128 px = b2Select(circles, _mm_mul_ps(half, _mm_add_ps(planeX, clipX)), clipX);
+		__m128 py = b2Select(circles, _mm_mul_ps(half, _mm_add_ps(planeY, clipY)), clipY);
+
+		__m128 rax = _mm_sub_ps(px, cax), ray = _mm_sub_ps(py, cay);
+		__m128 rbx = _mm_sub_ps(px, cbx), rby = _mm_sub_ps(py, cby);
+
+		// Track max constraint error.
+		minSep = _mm_min_ps(minSep, separation);
+
+		// Prevent large corrections and allow slop.
+		__m128 C = _mm_max_ps(maxCorrection, _mm_min_ps(_mm_mul_ps(baumgarte, _mm_add_ps(separation, slop)), zero));
+
+		// Compute the effective mass.
+		__m128 rnA = _mm_sub_ps(_mm_mul_ps(rax, ny), _mm_mul_ps(ray, nx));
+		__m128 rnB = _mm_sub_ps(_mm_mul_ps(rbx, ny), _mm_mul_ps(rby, nx));
+		__m128 K = _mm_add_ps(_mm_add_ps(_mm_add_ps(mA, mB), _mm_mul_ps(_mm_mul_ps(iA, rnA), rnA)), _mm_mul_ps(_mm_mul_ps(iB, rnB), rnB));
+
+		// Compute normal impulse
+		__m128 positive = _mm_cmpgt_ps(K, zero);
+		__m128 impulse = b2Select(positive, _mm_div_ps(_mm_sub_ps(zero, C), b2Select(positive, K, one)), zero);
+
+		__m128 Px = _mm_mul_ps(impulse, nx);
+		__m128 Py = _mm_mul_ps(impulse, ny);
+
+		cax = _mm_sub_ps(cax, _mm_mul_ps(mA, Px));
+		cay = _mm_sub_ps(cay, _mm_mul_ps(mA, Py));
+		aa = _mm_sub_ps(aa, _mm_mul_ps(iA, _mm_sub_ps(_mm_mul_ps(rax, Py), _mm_mul_ps(ray, Px))));
+
+		cbx = _mm_add_ps(cbx, _mm_mul_ps(mB, Px));
+		cby = _mm_add_ps(cby, _mm_mul_ps(mB, Py));
+		ab = _mm_add_ps(ab, _mm_mul_ps(iB, _mm_sub_ps(_mm_mul_ps(rbx, Py), _mm_mul_ps(rby, Px))));
+
+		_mm_storeu_ps(cAX, cax);
+		_mm_storeu_ps(cAY, cay);
+		_mm_storeu_ps(aAs, aa);
+		_mm_storeu_ps(cBX, cbx);
+		_mm_storeu_ps(cBY, cby);
+		_mm_storeu_ps(aBs, ab);
+
+		// Scatter. Lanes only share static or kinematic bodies, whose positions come
+		// back unchanged.
+		for (int32 lane = 0; lane < count; ++lane)
+		{
+			b2Position& a = m_positions[wc->indexA[lane]];
+			b2Position& b = m_positions[wc->indexB[lane]];
+			a.c.Set(cAX[lane], cAY[lane]);
+			a.a = aAs[lane];
+			b.c.Set(cBX[lane], cBY[lane]);
+			b.a = aBs[lane];
+		}
+	}
+
+	float separations[4];
+	_mm_storeu_ps(separations, minSep);
+	minSeparation = b2Min(b2Min(separations[0], separations[1]), b2Min(separations[2], separations[3]));
+#endif
+
+	return minSeparation;
+}
+
 // Sequential solver.
 bool b2ContactSolver::SolvePositionConstraints()
 {
-	float minSeparation = 0.0f;
+	float minSeparation = SolveWidePositionConstraints();
 
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 s = 0; s < m_scalarCount; ++s)
 	{
+		int32 i = (m_scalarIndices != nullptr) ? m_scalarIndices[s] : s;
 		b2ContactPositionConstraint* pc = m_positionConstraints + i;
 
 		int32 indexA = pc->indexA;
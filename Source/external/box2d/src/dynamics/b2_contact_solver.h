@@ -61,6 +61,41 @@ struct b2ContactVelocityConstraint
 	int32 contactIndex;
 };
 
+/// Four one point contacts without a dynamic body in common, in structure of
+/// arrays form for the SIMD velocity solver. Lanes past count are zero.
+struct b2WideConstraint
+{
+	float normalX[4], normalY[4];
+	float rAX[4], rAY[4];
+	float rBX[4], rBY[4];
+	float invMassA[4], invIA[4];
+	float invMassB[4], invIB[4];
+	float friction[4];
+	float tangentSpeed[4];
+	float normalMass[4];
+	float tangentMass[4];
+	float velocityBias[4];
+	float normalImpulse[4];
+	float tangentImpulse[4];
+	int32 indexA[4], indexB[4];
+	int32 constraint[4];
+	int32 count;
+};
+
+/// Position data of the same four contacts as the b2WideConstraint of the same
+/// index, for the SIMD position solver. Lanes past its count are zero.
+struct b2WidePositionConstraint
+{
+	float localNormalX[4], localNormalY[4];
+	float localPointX[4], localPointY[4];
+	float incidentPointX[4], incidentPointY[4];	///< localPoints[0]
+	float localCenterAX[4], localCenterAY[4];
+	float localCenterBX[4], localCenterBY[4];
+	float radius[4];							///< radiusA + radiusB
+	float circles[4];							///< 1 for b2Manifold::e_circles
+	float faceB[4];								///< 1 for b2Manifold::e_faceB
+};
+
 struct b2ContactSolverDef
 {
 	b2TimeStep step;
@@ -68,6 +103,7 @@ struct b2ContactSolverDef
 	int32 count;
 	b2Position* positions;
 	b2Velocity* velocities;
+	const int32* sharedIndices;
 	b2StackAllocator* allocator;
 };
 
@@ -84,6 +120,9 @@ public:
 	void StoreImpulses();
 
 	bool SolvePositionConstraints();
+	void PrepareWideConstraints();
+	void SolveWideVelocityConstraints();
+	float SolveWidePositionConstraints();
 	bool SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB);
 
 	b2TimeStep m_step;
@@ -94,6 +133,15 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+
+	// Constraints left to the scalar solver, all of them when m_scalarIndices is null
+	int32* m_scalarIndices;
+	int32 m_scalarCount;
+	b2WideConstraint* m_wideConstraints;
+	b2WidePositionConstraint* m_widePositions;
+	int32 m_wideCount;
+	uint32* m_bodyColors;
+	int32* m_wideOrder;
 };
 
 #endif
@@ -161,11 +161,13 @@ b2Island::b2Island(
 	m_contactCapacity = contactCapacity;
 	m_jointCapacity	 = jointCapacity;
 	m_bodyCount = 0;
+	m_sharedCount = 0;
 	m_contactCount = 0;
 	m_jointCount = 0;
 
 	m_allocator = allocator;
 	m_listener = listener;
+	m_sharedIndices = nullptr;
 
 	m_bodies = (b2Body**)m_allocator->Allocate(bodyCapacity * sizeof(b2Body*));
 	m_contacts = (b2Contact**)m_allocator->Allocate(contactCapacity	 * sizeof(b2Contact*));
@@ -201,9 +203,13 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		b2Vec2 v = b->m_linearVelocity;
 		float w = b->m_angularVelocity;
 
-		// Store positions for continuous collision.
-		b->m_sweep.c0 = b->m_sweep.c;
-		b->m_sweep.a0 = b->m_sweep.a;
+		// Store positions for continuous collision. Shared bodies are static,
+		// c0 already equals c
+		if (i >= m_sharedCount)
+		{
+			b->m_sweep.c0 = b->m_sweep.c;
+			b->m_sweep.a0 = b->m_sweep.a;
+		}
 
 		if (b->m_type == b2_dynamicBody)
 		{
@@ -235,6 +241,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	solverData.step = step;
 	solverData.positions = m_positions;
 	solverData.velocities = m_velocities;
+	solverData.sharedIndices = m_sharedIndices;
 
 	// Initialize velocity constraints.
 	b2ContactSolverDef contactSolverDef;
@@ -243,6 +250,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	contactSolverDef.count = m_contactCount;
 	contactSolverDef.positions = m_positions;
 	contactSolverDef.velocities = m_velocities;
+	contactSolverDef.sharedIndices = m_sharedIndices;
 	contactSolverDef.allocator = m_allocator;
 
 	b2ContactSolver contactSolver(&contactSolverDef);
@@ -331,8 +339,8 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		}
 	}
 
-	// Copy state buffers back to the bodies
-	for (int32 i = 0; i < m_bodyCount; ++i)
+	// Copy state buffers back to the bodies, shared bodies did not move
+	for (int32 i = m_sharedCount; i < m_bodyCount; ++i)
 	{
 		b2Body* body = m_bodies[i];
 		body->m_sweep.c = m_positions[i].c;
@@ -408,6 +416,7 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 	contactSolverDef.step = subStep;
 	contactSolverDef.positions = m_positions;
 	contactSolverDef.velocities = m_velocities;
+	contactSolverDef.sharedIndices = nullptr;
 	b2ContactSolver contactSolver(&contactSolverDef);
 
 	// Solve position constraints.
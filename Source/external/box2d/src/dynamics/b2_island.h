@@ -45,6 +45,7 @@ public:
 	void Clear()
 	{
 		m_bodyCount = 0;
+		m_sharedCount = 0;
 		m_contactCount = 0;
 		m_jointCount = 0;
 	}
@@ -61,6 +62,16 @@ public:
 		++m_bodyCount;
 	}
 
+	/// Static body shared with islands solved at the same time. Add them first,
+	/// their island index comes from m_sharedIndices and the solver never writes to them.
+	void AddShared(b2Body* body)
+	{
+		b2Assert(m_bodyCount == m_sharedCount && m_bodyCount < m_bodyCapacity);
+		b2Assert(body->m_type == b2_staticBody && m_sharedIndices[body->m_islandIndex] == m_bodyCount);
+		m_bodies[m_bodyCount++] = body;
+		++m_sharedCount;
+	}
+
 	void Add(b2Contact* contact)
 	{
 		b2Assert(m_contactCount < m_contactCapacity);
@@ -85,7 +96,11 @@ public:
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
 
+	// Island index of each shared static body by its index among all of them, null without shared bodies
+	const int32* m_sharedIndices;
+
 	int32 m_bodyCount;
+	int32 m_sharedCount;
 	int32 m_jointCount;
 	int32 m_contactCount;
 
@@ -72,8 +72,8 @@ b2RevoluteJoint::b2RevoluteJoint(const b2RevoluteJointDef* def)
 
 void b2RevoluteJoint::InitVelocityConstraints(const b2SolverData& data)
 {
-	m_indexA = m_bodyA->m_islandIndex;
-	m_indexB = m_bodyB->m_islandIndex;
+	m_indexA = m_bodyA->GetIslandIndex(data.sharedIndices);
+	m_indexB = m_bodyB->GetIslandIndex(data.sharedIndices);
 	m_localCenterA = m_bodyA->m_sweep.localCenter;
 	m_localCenterB = m_bodyB->m_sweep.localCenter;
 	m_invMassA = m_bodyA->m_invMass;
@@ -375,6 +375,22 @@ float b2RevoluteJoint::GetMotorTorque(float inv_dt) const
 	return inv_dt * m_motorImpulse;
 }
 
+void b2RevoluteJoint::GetImpulses(b2Vec2& impulse, float& motorImpulse, float& lowerImpulse, float& upperImpulse) const
+{
+	impulse = m_impulse;
+	motorImpulse = m_motorImpulse;
+	lowerImpulse = m_lowerImpulse;
+	upperImpulse = m_upperImpulse;
+}
+
+void b2RevoluteJoint::SetImpulses(const b2Vec2& impulse, float motorImpulse, float lowerImpulse, float upperImpulse)
+{
+	m_impulse = impulse;
+	m_motorImpulse = motorImpulse;
+	m_lowerImpulse = lowerImpulse;
+	m_upperImpulse = upperImpulse;
+}
+
 void b2RevoluteJoint::SetMotorSpeed(float speed)
 {
 	if (speed != m_motorSpeed)
@@ -45,6 +45,10 @@ b2World::b2World(const b2Vec2& gravity)
 	m_destructionListener = nullptr;
 	m_debugDraw = nullptr;
 
+	m_taskExecutor = nullptr;
+	m_workerAllocators = nullptr;
+	m_workerCount = 0;
+
 	m_bodyList = nullptr;
 	m_jointList = nullptr;
 
@@ -67,6 +71,7 @@ b2World::b2World(const b2Vec2& gravity)
 	m_inv_dt0 = 0.0f;
 
 	m_contactManager.m_allocator = &m_blockAllocator;
+	m_contactManager.m_stackAllocator = &m_stackAllocator;
 
 	memset(&m_profile, 0, sizeof(b2Profile));
 }
@@ -90,6 +95,44 @@ b2World::~b2World()
 
 		b = bNext;
 	}
+
+	FreeWorkerAllocators();
+}
+
+void b2World::SetTaskExecutor(b2TaskExecutor* executor)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	FreeWorkerAllocators();
+	m_taskExecutor = executor;
+	m_contactManager.m_taskExecutor = executor;
+
+	if (executor != nullptr)
+	{
+		// Each worker solves its islands on its own stack
+		m_workerCount = b2Max(executor->GetWorkerCount(), 1);
+		m_workerAllocators = (b2StackAllocator*)b2Alloc(m_workerCount * sizeof(b2StackAllocator));
+		for (int32 i = 0; i < m_workerCount; ++i)
+		{
+			new (m_workerAllocators + i) b2StackAllocator;
+		}
+	}
+}
+
+void b2World::FreeWorkerAllocators()
+{
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		m_workerAllocators[i].~b2StackAllocator();
+	}
+
+	b2Free(m_workerAllocators);
+	m_workerAllocators = nullptr;
+	m_workerCount = 0;
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -397,13 +440,6 @@ void b2World::Solve(const b2TimeStep& step)
 	m_profile.solveVelocity = 0.0f;
 	m_profile.solvePosition = 0.0f;
 
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount,
-					m_contactManager.m_contactCount,
-					m_jointCount,
-					&m_stackAllocator,
-					m_contactManager.m_contactListener);
-
 	// Clear all the island flags.
 	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
@@ -418,9 +454,235 @@ void b2World::Solve(const b2TimeStep& step)
 		j->m_islandFlag = false;
 	}
 
-	// Build and simulate all awake islands.
+	if (m_taskExecutor != nullptr)
+	{
+		SolveParallel(step);
+	}
+	else
+	{
+		// Size the island for the worst case.
+		b2Island island(m_bodyCount,
+						m_contactManager.m_contactCount,
+						m_jointCount,
+						&m_stackAllocator,
+						m_contactManager.m_contactListener);
+
+		// Build and simulate all awake islands.
+		int32 stackSize = m_bodyCount;
+		b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+		for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+		{
+			if (seed->m_flags & b2Body::e_islandFlag)
+			{
+				continue;
+			}
+
+			if (seed->IsAwake() == false || seed->IsEnabled() == false)
+			{
+				continue;
+			}
+
+			// The seed can be dynamic or kinematic.
+			if (seed->GetType() == b2_staticBody)
+			{
+				continue;
+			}
+
+			// Reset island and stack.
+			island.Clear();
+			int32 stackCount = 0;
+			stack[stackCount++] = seed;
+			seed->m_flags |= b2Body::e_islandFlag;
+
+			// Perform a depth first search (DFS) on the constraint graph.
+			while (stackCount > 0)
+			{
+				// Grab the next body off the stack and add it to the island.
+				b2Body* b = stack[--stackCount];
+				b2Assert(b->IsEnabled() == true);
+				island.Add(b);
+
+				// To keep islands as small as possible, we don't
+				// propagate islands across static bodies.
+				if (b->GetType() == b2_staticBody)
+				{
+					continue;
+				}
+
+				// Make sure the body is awake (without resetting sleep timer).
+				b->m_flags |= b2Body::e_awakeFlag;
+
+				// Search all contacts connected to this body.
+				for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+				{
+					b2Contact* contact = ce->contact;
+
+					// Has this contact already been added to an island?
+					if (contact->m_flags & b2Contact::e_islandFlag)
+					{
+						continue;
+					}
+
+					// Is this contact solid and touching?
+					if (contact->IsEnabled() == false ||
+						contact->IsTouching() == false)
+					{
+						continue;
+					}
+
+					// Skip sensors.
+					bool sensorA = contact->m_fixtureA->m_isSensor;
+					bool sensorB = contact->m_fixtureB->m_isSensor;
+					if (sensorA || sensorB)
+					{
+						continue;
+					}
+
+					island.Add(contact);
+					contact->m_flags |= b2Contact::e_islandFlag;
+
+					b2Body* other = ce->other;
+
+					// Was the other body already added to this island?
+					if (other->m_flags & b2Body::e_islandFlag)
+					{
+						continue;
+					}
+
+					b2Assert(stackCount < stackSize);
+					stack[stackCount++] = other;
+					other->m_flags |= b2Body::e_islandFlag;
+				}
+
+				// Search all joints connect to this body.
+				for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+				{
+					if (je->joint->m_islandFlag == true)
+					{
+						continue;
+					}
+
+					b2Body* other = je->other;
+
+					// Don't simulate joints connected to diabled bodies.
+					if (other->IsEnabled() == false)
+					{
+						continue;
+					}
+
+					island.Add(je->joint);
+					je->joint->m_islandFlag = true;
+
+					if (other->m_flags & b2Body::e_islandFlag)
+					{
+						continue;
+					}
+
+					b2Assert(stackCount < stackSize);
+					stack[stackCount++] = other;
+					other->m_flags |= b2Body::e_islandFlag;
+				}
+			}
+
+			b2Profile profile;
+			island.Solve(&profile, step, m_gravity, m_allowSleep);
+			m_profile.solveInit += profile.solveInit;
+			m_profile.solveVelocity += profile.solveVelocity;
+			m_profile.solvePosition += profile.solvePosition;
+
+			// Post solve cleanup.
+			for (int32 i = 0; i < island.m_bodyCount; ++i)
+			{
+				// Allow static bodies to participate in other islands.
+				b2Body* b = island.m_bodies[i];
+				if (b->GetType() == b2_staticBody)
+				{
+					b->m_flags &= ~b2Body::e_islandFlag;
+				}
+			}
+		}
+
+		m_stackAllocator.Free(stack);
+	}
+
+	{
+		b2Timer timer;
+		// Synchronize fixtures, check for out of range bodies.
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			// If a body was not in an island then it did not move.
+			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			{
+				continue;
+			}
+
+			if (b->GetType() == b2_staticBody)
+			{
+				continue;
+			}
+
+			// Update fixtures (for broad-phase).
+			b->SynchronizeFixtures();
+		}
+
+		// Look for new contacts.
+		m_contactManager.FindNewContacts();
+		m_profile.broadphase = timer.GetMilliseconds();
+	}
+}
+
+// Bodies, contacts and joints of one island in the arrays of b2IslandTasks
+struct b2IslandRange
+{
+	int32 sharedStart, sharedCount;
+	int32 bodyStart, bodyCount;
+	int32 contactStart, contactCount;
+	int32 jointStart, jointCount;
+	b2Profile profile;
+};
+
+struct b2IslandTasks
+{
+	b2World* world;
+	const b2TimeStep* step;
+	b2Body** shared;			// static bodies reached this step, by m_islandIndex
+	int32 sharedCount;
+	b2Body** islandShared;		// static bodies each island reaches, once per island
+	b2Body** bodies;
+	b2Contact** contacts;
+	b2Joint** joints;
+	b2IslandRange* islands;
+};
+
+// Builds every island with the same search as Solve before solving any of them,
+// then solves them through the task executor. Static bodies are not part of one
+// island: each island lists the ones its contacts and joints reach and puts them
+// first, remapped to its own indices, and no worker writes to them.
+void b2World::SolveParallel(const b2TimeStep& step)
+{
+	b2IslandTasks tasks;
+	tasks.world = this;
+	tasks.step = &step;
+	tasks.sharedCount = 0;
+	tasks.shared = (b2Body**)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2Body*));
+	tasks.islandShared = (b2Body**)m_stackAllocator.Allocate((m_contactManager.m_contactCount + m_jointCount) * sizeof(b2Body*));
+	tasks.bodies = (b2Body**)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2Body*));
+	tasks.contacts = (b2Contact**)m_stackAllocator.Allocate(m_contactManager.m_contactCount * sizeof(b2Contact*));
+	tasks.joints = (b2Joint**)m_stackAllocator.Allocate(m_jointCount * sizeof(b2Joint*));
+	tasks.islands = (b2IslandRange*)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2IslandRange));
+
+	int32 islandSharedCount = 0;
+	int32 bodyCount = 0;
+	int32 contactCount = 0;
+	int32 jointCount = 0;
+	int32 islandCount = 0;
+
 	int32 stackSize = m_bodyCount;
 	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+
+	// Last island that listed each shared body
+	int32* sharedIsland = (int32*)m_stackAllocator.Allocate(m_bodyCount * sizeof(int32));
+
 	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
 	{
 		if (seed->m_flags & b2Body::e_islandFlag)
@@ -439,8 +701,13 @@ void b2World::Solve(const b2TimeStep& step)
 			continue;
 		}
 
-		// Reset island and stack.
-		island.Clear();
+		int32 islandIndex = islandCount++;
+		b2IslandRange* island = tasks.islands + islandIndex;
+		island->sharedStart = islandSharedCount;
+		island->bodyStart = bodyCount;
+		island->contactStart = contactCount;
+		island->jointStart = jointCount;
+
 		int32 stackCount = 0;
 		stack[stackCount++] = seed;
 		seed->m_flags |= b2Body::e_islandFlag;
@@ -448,17 +715,10 @@ void b2World::Solve(const b2TimeStep& step)
 		// Perform a depth first search (DFS) on the constraint graph.
 		while (stackCount > 0)
 		{
-			// Grab the next body off the stack and add it to the island.
 			b2Body* b = stack[--stackCount];
 			b2Assert(b->IsEnabled() == true);
-			island.Add(b);
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->GetType() == b2_staticBody)
-			{
-				continue;
-			}
+			tasks.bodies[bodyCount++] = b;
 
 			// Make sure the body is awake (without resetting sleep timer).
 			b->m_flags |= b2Body::e_awakeFlag;
@@ -489,20 +749,40 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
-				island.Add(contact);
+				tasks.contacts[contactCount++] = contact;
 				contact->m_flags |= b2Contact::e_islandFlag;
 
 				b2Body* other = ce->other;
 
+				// Static bodies are not propagated, the island lists each one once.
+				if (other->GetType() == b2_staticBody)
+				{
+					if ((other->m_flags & b2Body::e_islandFlag) == 0)
+					{
+						other->m_flags |= b2Body::e_islandFlag;
+						other->m_islandIndex = tasks.sharedCount;
+						tasks.shared[tasks.sharedCount++] = other;
+						sharedIsland[other->m_islandIndex] = -1;
+					}
+
+					if (sharedIsland[other->m_islandIndex] != islandIndex)
+					{
+						sharedIsland[other->m_islandIndex] = islandIndex;
+						tasks.islandShared[islandSharedCount++] = other;
+					}
+					continue;
+				}
+
 				// Was the other body already added to this island?
 				if (other->m_flags & b2Body::e_islandFlag)
 				{
 					continue;
 				}
 
+				other->m_flags |= b2Body::e_islandFlag;
+
 				b2Assert(stackCount < stackSize);
 				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
 			}
 
 			// Search all joints connect to this body.
@@ -521,64 +801,137 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
-				island.Add(je->joint);
+				tasks.joints[jointCount++] = je->joint;
 				je->joint->m_islandFlag = true;
 
+				// Static bodies are not propagated, the island lists each one once.
+				if (other->GetType() == b2_staticBody)
+				{
+					if ((other->m_flags & b2Body::e_islandFlag) == 0)
+					{
+						other->m_flags |= b2Body::e_islandFlag;
+						other->m_islandIndex = tasks.sharedCount;
+						tasks.shared[tasks.sharedCount++] = other;
+						sharedIsland[other->m_islandIndex] = -1;
+					}
+
+					if (sharedIsland[other->m_islandIndex] != islandIndex)
+					{
+						sharedIsland[other->m_islandIndex] = islandIndex;
+						tasks.islandShared[islandSharedCount++] = other;
+					}
+					continue;
+				}
+
 				if (other->m_flags & b2Body::e_islandFlag)
 				{
 					continue;
 				}
 
+				other->m_flags |= b2Body::e_islandFlag;
+
 				b2Assert(stackCount < stackSize);
 				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
 			}
 		}
 
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
-
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
-		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
-			if (b->GetType() == b2_staticBody)
-			{
-				b->m_flags &= ~b2Body::e_islandFlag;
-			}
-		}
+		island->sharedCount = islandSharedCount - island->sharedStart;
+		island->bodyCount = bodyCount - island->bodyStart;
+		island->contactCount = contactCount - island->contactStart;
+		island->jointCount = jointCount - island->jointStart;
 	}
 
+	m_stackAllocator.Free(sharedIsland);
 	m_stackAllocator.Free(stack);
 
+	m_taskExecutor->ParallelFor(islandCount, &b2World::SolveIslandTask, &tasks);
+
+	b2ContactListener* listener = m_contactManager.m_contactListener;
+
+	for (int32 i = 0; i < islandCount; ++i)
 	{
-		b2Timer timer;
-		// Synchronize fixtures, check for out of range bodies.
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		const b2IslandRange& island = tasks.islands[i];
+		m_profile.solveInit += island.profile.solveInit;
+		m_profile.solveVelocity += island.profile.solveVelocity;
+		m_profile.solvePosition += island.profile.solvePosition;
+
+		if (listener == nullptr)
 		{
-			// If a body was not in an island then it did not move.
-			if ((b->m_flags & b2Body::e_islandFlag) == 0)
-			{
-				continue;
-			}
+			continue;
+		}
 
-			if (b->GetType() == b2_staticBody)
+		// Same calls b2Island::Report makes, the solver stored the impulses in the manifolds
+		for (int32 j = 0; j < island.contactCount; ++j)
+		{
+			b2Contact* c = tasks.contacts[island.contactStart + j];
+			const b2Manifold* manifold = c->GetManifold();
+
+			b2ContactImpulse impulse;
+			impulse.count = manifold->pointCount;
+			for (int32 k = 0; k < manifold->pointCount; ++k)
 			{
-				continue;
+				impulse.normalImpulses[k] = manifold->points[k].normalImpulse;
+				impulse.tangentImpulses[k] = manifold->points[k].tangentImpulse;
 			}
 
-			// Update fixtures (for broad-phase).
-			b->SynchronizeFixtures();
+			listener->PostSolve(c, &impulse);
 		}
+	}
 
-		// Look for new contacts.
-		m_contactManager.FindNewContacts();
-		m_profile.broadphase = timer.GetMilliseconds();
+	// Allow static bodies to participate in other islands.
+	for (int32 i = 0; i < tasks.sharedCount; ++i)
+	{
+		tasks.shared[i]->m_flags &= ~b2Body::e_islandFlag;
 	}
+
+	m_stackAllocator.Free(tasks.islands);
+	m_stackAllocator.Free(tasks.joints);
+	m_stackAllocator.Free(tasks.contacts);
+	m_stackAllocator.Free(tasks.bodies);
+	m_stackAllocator.Free(tasks.islandShared);
+	m_stackAllocator.Free(tasks.shared);
+}
+
+void b2World::SolveIslandTask(void* context, int32 index, int32 worker)
+{
+	b2IslandTasks* tasks = (b2IslandTasks*)context;
+	b2World* world = tasks->world;
+	b2IslandRange* range = tasks->islands + index;
+
+	b2StackAllocator* allocator = world->m_workerAllocators + worker;
+
+	b2Island island(range->sharedCount + range->bodyCount,
+					range->contactCount,
+					range->jointCount,
+					allocator,
+					nullptr);
+
+	// Only the entries of this island's shared bodies are written
+	int32* sharedIndices = (int32*)allocator->Allocate(tasks->sharedCount * sizeof(int32));
+	island.m_sharedIndices = sharedIndices;
+
+	for (int32 i = 0; i < range->sharedCount; ++i)
+	{
+		b2Body* body = tasks->islandShared[range->sharedStart + i];
+		sharedIndices[body->m_islandIndex] = i;
+		island.AddShared(body);
+	}
+	for (int32 i = 0; i < range->bodyCount; ++i)
+	{
+		island.Add(tasks->bodies[range->bodyStart + i]);
+	}
+	for (int32 i = 0; i < range->contactCount; ++i)
+	{
+		island.Add(tasks->contacts[range->contactStart + i]);
+	}
+	for (int32 i = 0; i < range->jointCount; ++i)
+	{
+		island.Add(tasks->joints[range->jointStart + i]);
+	}
+
+	island.Solve(&range->profile, *tasks->step, world->m_gravity, world->m_allowSleep);
+
+	allocator->Free(sharedIndices);
 }
 
 // Find TOI contacts and solve them.
@@ -1234,6 +1587,17 @@ float b2World::GetTreeQuality() const
 	return m_contactManager.m_broadPhase.GetTreeQuality();
 }
 
+void b2World::RebuildTree()
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_contactManager.m_broadPhase.RebuildTree();
+}
+
 void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	b2Assert(m_locked == false);